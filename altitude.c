@@ -4,7 +4,7 @@
 // Stores altitude and is used to set the target altitude
 //
 // Author:  bma206, tki36
-// Last modified:   21.5.2024
+// Last modified:   19.10.2026
 //
 //*****************************************************************************
 // Based on 'lab 4 ADCdemo1.c' from 2024  
@@ -15,6 +15,8 @@
 #include "circBufT.h"
 #include "altitude.h"
 #include "switch.h"
+#include "params.h"
+#include "latency.h"
 #include "inc/hw_memmap.h"
 #include "inc/hw_types.h"
 #include "driverlib/adc.h"
@@ -28,8 +30,12 @@
 
 // Altitude range for 1V
 static int32_t altitudeRange = 1240; //1190;
-// Altitude circular buffer
+// Altitude circular buffer, and the running sum of its samples
 static circBuf_t g_inBuffer;
+static volatile int32_t g_inBufferSum = 0;
+
+// Called after each new sample, can be NULL
+static void (*sampleHandler)(void) = NULL;
 
 int32_t baseAltitude;   // Base altitude
 int32_t altitudePercentage;
@@ -43,16 +49,32 @@ void ADCIntHandler()
 {
     uint32_t ulValue;
 
+    markLatency(LAT_ADC_SAMPLE);
     //
     // Get the single sample from ADC0.  ADC_BASE is defined in
     // inc/hw_memmap.h
     ADCSequenceDataGet(ADC_BASE, 3, &ulValue);
     //
-    // Place it in the circular buffer (advancing write index)
+    // Update the running sum with the sample replacing the oldest one,
+    // then place it in the circular buffer (advancing write index)
+    g_inBufferSum += (int32_t)ulValue - (int32_t)g_inBuffer.data[g_inBuffer.windex];
     writeCircBuf (&g_inBuffer, ulValue);
     //
     // Clean up, clearing the interrupt
     ADCIntClear(ADC_BASE, 3);
+    markLatency(LAT_ADC_FILTERED);
+
+    if (sampleHandler != NULL) {
+        sampleHandler();
+    }
+}
+
+//
+// Sets a function to call after each new sample, from the ADC interrupt
+//
+void setAltitudeSampleHandler(void (*handler)(void))
+{
+    sampleHandler = handler;
 }
 
 
@@ -100,21 +122,20 @@ void initAltitude(void)
 {
     initADC();
     initCircBuf(&g_inBuffer, BUF_SIZE);
+
+    registerParam(PARAM_ALT_RANGE, "alt_range", PARAM_INT, &altitudeRange, 100, 4095, NULL);
 }
 
 //
 // Background task: calculate the (approximate) mean of the values in the
 // circular buffer and display it, together with the sample number.
+// The sum is kept up to date by the ADC interrupt.
 //
 int getAltitudeADC()
 {
-    uint16_t i;
-    int32_t sum = 0;
-    int32_t altitude = 0;
-    // Reads the circ buffer to get the average
-    for (i = 0; i < BUF_SIZE; i++)
-        sum = sum + readCircBuf (&g_inBuffer);
-    altitude = (2 * sum + BUF_SIZE) / 2 / BUF_SIZE;
+    int32_t sum = g_inBufferSum;
+    markLatency(LAT_ALT_READ);
+    int32_t altitude = (2 * sum + BUF_SIZE) / 2 / BUF_SIZE;
     return altitude;
 }
 
@@ -188,6 +209,23 @@ int32_t getAltitude(void)
     return alt;
 }
 
+//
+// Gets the altitude from the last update, as a percentage
+//
+int32_t getMeasuredAltitude(void)
+{
+    return altitudePercentage;
+}
+
+//
+// Recalculates the current altitude from the latest ADC samples
+//
+void updateAltitude(void)
+{
+    int16_t alt;
+    getAltitudePercentage(getAltitudeADC(), &alt);
+}
+
 //
 // Gets the difference between target and current altitude
 //
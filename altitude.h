@@ -7,7 +7,7 @@
 // for setting the altitude
 //
 // Author:  bma206, tki36
-// Last modified:   21.5.2024
+// Last modified:   19.10.2026
 //
 //*****************************************************************************
 
@@ -30,6 +30,11 @@ void ADCIntHandler(void);
 //
 void initAltitude(void);
 
+//
+// Sets a function to call after each new sample, from the ADC interrupt
+//
+void setAltitudeSampleHandler(void (*handler)(void));
+
 //
 // Background task: calculate the (approximate) mean of the values in the
 // circular buffer and display it, together with the sample number.
@@ -57,6 +62,17 @@ void setBaseAltitude(int32_t base);
 //
 int32_t getBaseAltitude(void);
 
+//
+// Recalculates the current altitude from the latest ADC samples
+//
+void updateAltitude(void);
+
+//
+// Gets the altitude from the last update, as a percentage.  Doesn't read
+// the ADC.
+//
+int32_t getMeasuredAltitude(void);
+
 //
 // Gets the difference between target and current altitude
 //
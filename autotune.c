@@ -0,0 +1,245 @@
+//*****************************************************************************
+//
+// autotune.c - Relay feedback autotune of the altitude and yaw PIDs.
+// The rotor duty is switched between bias +/- d whenever the error crosses
+// the hysteresis band, which makes the heli oscillate at its ultimate
+// period Tu with amplitude a.  The ultimate gain is Ku = 4d / (pi * a) and
+// the gains come from the Tyreus-Luyben rules.  Altitude is tuned first,
+// then yaw, each while the other loop holds position.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "altitude.h"
+#include "yaw.h"
+#include "pwm.h"
+#include "pid.h"
+#include "timer.h"
+#include "control.h"
+#include "autotune.h"
+
+// Relay steps, in duty %
+#define ALT_RELAY_DUTY      10
+#define YAW_RELAY_DUTY      10
+
+// Relay hysteresis, in altitude % and tenths of a degree
+#define ALT_RELAY_HYST      1
+#define YAW_RELAY_HYST      20
+
+// Cycles to skip while the oscillation builds up, then cycles to measure
+#define SETTLE_CYCLES       2
+#define MEASURE_CYCLES      4
+
+// Gives up on an axis if it doesn't finish within this time, in seconds
+#define AXIS_TIMEOUT        30
+
+// Aborts if the heli leaves this altitude range, in %
+#define SAFE_MIN_ALTITUDE   5
+#define SAFE_MAX_ALTITUDE   95
+
+#define PI PID_FROM_FLOAT(3.14159f)
+
+// Axis being tuned
+enum tuneAxes {TUNE_ALTITUDE = 0, TUNE_YAW, TUNE_DONE};
+typedef enum tuneAxes tuneAxis_t;
+
+//
+// Relay experiment state for one axis
+//
+typedef struct {
+    int32_t bias;           // Duty the relay switches around, in %
+    int32_t step;           // Relay step, in duty %
+    int32_t hysteresis;
+    bool high;              // Relay is at bias + step
+    uint8_t cycles;         // Completed oscillation cycles
+    int32_t errorMax;       // Error extremes over the current cycle
+    int32_t errorMin;
+    int32_t sumPeakToPeak;  // Sums over the measured cycles
+    uint32_t sumPeriod;     // In timer ticks
+    uint32_t cycleStart;    // Timestamp of the current cycle
+    uint32_t axisStart;     // Timestamp the axis started tuning
+} relay_t;
+
+static tuneAxis_t axis = TUNE_DONE;
+static relay_t relay;
+
+//
+// Starts a relay experiment at the given bias duty
+//
+static void startRelay(int32_t bias, int32_t step, int32_t hysteresis)
+{
+    relay.bias = bias;
+    relay.step = step;
+    relay.hysteresis = hysteresis;
+    relay.high = true;
+    relay.cycles = 0;
+    relay.errorMax = 0;
+    relay.errorMin = 0;
+    relay.sumPeakToPeak = 0;
+    relay.sumPeriod = 0;
+    relay.cycleStart = getTimestamp();
+    relay.axisStart = relay.cycleStart;
+}
+
+//
+// Steps the relay with the latest error and returns the duty to apply.
+// A cycle ends each time the relay switches high.
+//
+static int32_t updateRelay(int32_t error)
+{
+    if (error > relay.errorMax) {
+        relay.errorMax = error;
+    }
+    if (error < relay.errorMin) {
+        relay.errorMin = error;
+    }
+
+    if (relay.high && error < -relay.hysteresis) {
+        relay.high = false;
+    } else if (!relay.high && error > relay.hysteresis) {
+        relay.high = true;
+
+        uint32_t now = getTimestamp();
+        relay.cycles++;
+        if (relay.cycles > SETTLE_CYCLES) {
+            relay.sumPeakToPeak += relay.errorMax - relay.errorMin;
+            relay.sumPeriod += now - relay.cycleStart;
+        }
+        relay.cycleStart = now;
+        relay.errorMax = error;
+        relay.errorMin = error;
+    }
+
+    return relay.high ? relay.bias + relay.step : relay.bias - relay.step;
+}
+
+//
+// Checks if enough cycles have been measured
+//
+static bool isRelayDone(void)
+{
+    return relay.cycles >= SETTLE_CYCLES + MEASURE_CYCLES;
+}
+
+//
+// Checks if the relay has run for too long
+//
+static bool isRelayTimedOut(void)
+{
+    return getTimestamp() - relay.axisStart > AXIS_TIMEOUT * getTimerFrequency();
+}
+
+//
+// Works out the PID gains from the measured oscillation.  scale converts
+// the error units to the PID's units.  Returns false if the oscillation
+// was too small to use.
+//
+static bool computeGains(int32_t scale, pidNum_t *kp, pidNum_t *ki, pidNum_t *kd)
+{
+    // Amplitude is half the mean peak to peak
+    pidNum_t amplitude = PID_FROM_RATIO(relay.sumPeakToPeak, 2 * MEASURE_CYCLES * scale);
+    pidNum_t period = PID_FROM_RATIO(ticksToMicros(relay.sumPeriod / MEASURE_CYCLES), 1000000);
+
+    if (amplitude <= 0 || period <= 0) {
+        return false;
+    }
+
+    // Ultimate gain
+    pidNum_t ku = PID_DIV(PID_FROM_INT(4 * relay.step), PID_MUL(PI, amplitude));
+
+    // Tyreus-Luyben: Kp = Ku / 2.2, Ti = 2.2 Tu, Td = Tu / 6.3
+    *kp = PID_DIV(ku, PID_FROM_FLOAT(2.2f));
+    *ki = PID_DIV(ku, PID_MUL(PID_FROM_FLOAT(4.84f), period));
+    *kd = PID_DIV(PID_MUL(ku, period), PID_FROM_FLOAT(13.86f));
+    return true;
+}
+
+//
+// Ends the autotune and hands both axes back to the PIDs.  The control
+// cycle primes them from the duties the relay left applied.
+//
+static void finishAutotune(void)
+{
+    axis = TUNE_DONE;
+    setAltitudeControlEnabled(true);
+    setYawControlEnabled(true);
+}
+
+//
+// Starts the autotune
+//
+void startAutotune(void)
+{
+    // Altitude first, relay around the current hover duty
+    axis = TUNE_ALTITUDE;
+    setAltitudeControlEnabled(false);
+    startRelay(getMainPower(), ALT_RELAY_DUTY, ALT_RELAY_HYST);
+}
+
+//
+// Stops the autotune early, keeping the old gains
+//
+void stopAutotune(void)
+{
+    finishAutotune();
+}
+
+//
+// Runs the relay experiment until it finishes or fails
+//
+void updateAutotune(void)
+{
+    pidNum_t kp, ki, kd;
+    int32_t altitudeError = getAltitudeError();
+    int32_t altitude = getTargetAltitude() - altitudeError;
+
+    if (axis == TUNE_DONE) {
+        return;
+    }
+
+    // Aborts if the experiment takes the heli too close to its limits
+    if (altitude < SAFE_MIN_ALTITUDE || altitude > SAFE_MAX_ALTITUDE || isRelayTimedOut()) {
+        finishAutotune();
+        return;
+    }
+
+    if (axis == TUNE_ALTITUDE) {
+        setMainPower(updateRelay(altitudeError));
+
+        if (isRelayDone()) {
+            if (computeGains(1, &kp, &ki, &kd)) {
+                setAltitudeGains(kp, ki, kd);
+            }
+
+            // Yaw next, relay around the current tail duty
+            setAltitudeControlEnabled(true);
+            setYawControlEnabled(false);
+            axis = TUNE_YAW;
+            startRelay(getTailPower(), YAW_RELAY_DUTY, YAW_RELAY_HYST);
+        }
+    } else if (axis == TUNE_YAW) {
+        getCurrentYaw(); // Updates the yaw used for the error
+        setTailPower(updateRelay(getYawError()));
+
+        if (isRelayDone()) {
+            // Yaw error is in tenths of a degree
+            if (computeGains(10, &kp, &ki, &kd)) {
+                setYawGains(kp, ki, kd);
+            }
+            finishAutotune();
+        }
+    }
+}
+
+//
+// Returns true once the autotune has finished or given up
+//
+bool isAutotuneDone(void)
+{
+    return axis == TUNE_DONE;
+}
@@ -0,0 +1,38 @@
+//*****************************************************************************
+//
+// autotune.h - Relay feedback autotune of the altitude and yaw PIDs.
+// Runs a relay experiment on the main rotor, then on the tail rotor,
+// measures the ultimate gain and period and sets new PID gains.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#ifndef AUTOTUNE_H_
+#define AUTOTUNE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//
+// Starts the autotune.  The AUTOTUNE flight state runs it.
+//
+void startAutotune(void);
+
+//
+// Stops the autotune early, keeping the old gains
+//
+void stopAutotune(void);
+
+//
+// Runs the relay experiment until it finishes or fails
+//
+void updateAutotune(void);
+
+//
+// Returns true once the autotune has finished or given up
+//
+bool isAutotuneDone(void);
+
+#endif /*AUTOTUNE_H_*/
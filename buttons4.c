@@ -138,3 +138,11 @@ checkButton (uint8_t butName)
 	return NO_CHANGE;
 }
 
+// *******************************************************
+// isButtonDown: Function returns true while the button's debounced
+// logical state is PUSHED.
+bool
+isButtonDown (uint8_t butName)
+{
+	return but_state[butName] != but_normal[butName];
+}
@@ -71,4 +71,10 @@ updateButtons (void);
 uint8_t
 checkButton (uint8_t butName);
 
+// *******************************************************
+// isButtonDown: Function returns true while the button's debounced
+// logical state is PUSHED.
+bool
+isButtonDown (uint8_t butName);
+
 #endif /*BUTTONS_H_*/
@@ -0,0 +1,75 @@
+//*****************************************************************************
+//
+// cobs.c - Consistent Overhead Byte Stuffing.  Removes every zero byte
+// from a frame so a zero can mark the end of it, at a cost of one byte
+// per 254.  No hardware dependencies, so host tools can build it.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#include <stdint.h>
+
+#include "cobs.h"
+
+//
+// Encodes len bytes into out.  Each block starts with a code byte giving
+// the distance to the next zero (or the end of a full 254 byte block).
+//
+uint16_t encodeCOBS(const uint8_t *in, uint16_t len, uint8_t *out)
+{
+    uint16_t codeIndex = 0;
+    uint16_t outIndex = 1;
+    uint8_t code = 1;
+    uint16_t i;
+
+    for (i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[codeIndex] = code;
+            codeIndex = outIndex++;
+            code = 1;
+        } else {
+            out[outIndex++] = in[i];
+            code++;
+            if (code == 0xFF) {
+                out[codeIndex] = code;
+                codeIndex = outIndex++;
+                code = 1;
+            }
+        }
+    }
+    out[codeIndex] = code;
+
+    return outIndex;
+}
+
+//
+// Decodes len bytes into out
+//
+int32_t decodeCOBS(const uint8_t *in, uint16_t len, uint8_t *out)
+{
+    uint16_t inIndex = 0;
+    uint16_t outIndex = 0;
+
+    while (inIndex < len) {
+        uint8_t code = in[inIndex++];
+        uint8_t i;
+
+        if (code == 0 || inIndex + code - 1 > len) {
+            return -1;
+        }
+        for (i = 1; i < code; i++) {
+            if (in[inIndex] == 0) {
+                return -1;
+            }
+            out[outIndex++] = in[inIndex++];
+        }
+
+        // A short block stands for a zero, except at the end
+        if (code < 0xFF && inIndex < len) {
+            out[outIndex++] = 0;
+        }
+    }
+    return outIndex;
+}
@@ -0,0 +1,32 @@
+//*****************************************************************************
+//
+// cobs.h - Consistent Overhead Byte Stuffing.  Removes every zero byte
+// from a frame so a zero can mark the end of it, at a cost of one byte
+// per 254.  No hardware dependencies, so host tools can build it.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#ifndef COBS_H_
+#define COBS_H_
+
+#include <stdint.h>
+
+// Largest encoded size of len bytes, not counting the end zero
+#define COBS_MAX_LEN(len) ((len) + (len) / 254 + 1)
+
+//
+// Encodes len bytes into out, which must hold COBS_MAX_LEN(len) bytes.
+// Returns the encoded length, the end zero isn't added.
+//
+uint16_t encodeCOBS(const uint8_t *in, uint16_t len, uint8_t *out);
+
+//
+// Decodes len bytes (without the end zero) into out, which must hold len
+// bytes.  Returns the decoded length, or -1 if the data isn't valid COBS.
+//
+int32_t decodeCOBS(const uint8_t *in, uint16_t len, uint8_t *out);
+
+#endif /*COBS_H_*/
@@ -3,12 +3,14 @@
 // control.c - Module for controlling the helicopter's motors with PID
 //
 // Author:  bma206, tki36
-// Last modified:   14.5.2024
+// Last modified:   19.10.2026
 //
 //*****************************************************************************
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 #include "inc/hw_memmap.h"
 #include "inc/hw_types.h"
 #include "driverlib/adc.h"
@@ -16,50 +18,589 @@
 #include "driverlib/sysctl.h"
 #include "driverlib/systick.h"
 #include "driverlib/interrupt.h"
+#include "utils/ustdlib.h"
 
 #include "altitude.h"
 #include "yaw.h"
 #include "pwm.h"
+#include "pid.h"
+#include "timer.h"
+#include "feedforward.h"
+#include "flight.h"
+#include "trajectory.h"
+#include "params.h"
+#include "latency.h"
+#include "lqr.h"
+#include "shaper.h"
+#include "serial.h"
+#include "recorder.h"
 
 #include "control.h"
 
-// Constants for calculating the PID
-static float ALT_KP = 1.2;
-static float ALT_KI = 2;
-static float ALT_KD = 0.1;
-static float YAW_KP = 1;
-static float YAW_KI = 3;
-static float YAW_KD = -0.1;
+// Altitude PID gains, scheduled by target altitude band.  Gains are
+// Q16.16 parameters.  Every band starts at the original single set of
+// gains, and is only changed once tuned on the rig.
+typedef struct {
+    int32_t minAltitude;    // Lowest target altitude of the band, in %
+    int32_t kp;
+    int32_t ki;
+    int32_t kd;
+} gainBand_t;
 
-// Prev values for the PID calculatiosn
-static float prevAltError = 0;
-static float prevAltI = 0;
-static float prevYawI = 0;
+static gainBand_t altGainBands[] = {
+    {0,  Q16_FROM_FLOAT(1.2f), Q16_FROM_FLOAT(2.0f), Q16_FROM_FLOAT(0.1f)},  // Ground effect
+    {30, Q16_FROM_FLOAT(1.2f), Q16_FROM_FLOAT(2.0f), Q16_FROM_FLOAT(0.1f)},
+    {70, Q16_FROM_FLOAT(1.2f), Q16_FROM_FLOAT(2.0f), Q16_FROM_FLOAT(0.1f)},
+};
+#define NUM_ALT_GAIN_BANDS (sizeof(altGainBands) / sizeof(altGainBands[0]))
 
-// Time step for PID
-static float deltaT = 0.05;
+// Parameter names of the altitude gains, kp/ki/kd per band
+static const char *altGainNames[NUM_ALT_GAIN_BANDS][3] = {
+    {"alt_kp0", "alt_ki0", "alt_kd0"},
+    {"alt_kp1", "alt_ki1", "alt_kd1"},
+    {"alt_kp2", "alt_ki2", "alt_kd2"},
+};
+
+// Yaw PID gains, Q16.16 parameters
+static int32_t yawKp = Q16_FROM_FLOAT(1.0f);
+static int32_t yawKi = Q16_FROM_FLOAT(3.0f);
+static int32_t yawKd = Q16_FROM_FLOAT(-0.1f);
+
+// Allowed range of the gain parameters
+#define MAX_GAIN Q16_FROM_FLOAT(20.0f)
+
+// Derivative settings per loop: differentiate the measurement (1) or the
+// error (0), and the derivative filter cutoff in Hz (Q16.16, 0 is off)
+static int32_t altDOnMeasurement = 1;
+static int32_t altDCutoff = Q16_FROM_FLOAT(5.0f);
+static int32_t yawDOnMeasurement = 1;
+static int32_t yawDCutoff = Q16_FROM_FLOAT(3.0f);
+#define MAX_D_CUTOFF Q16_FROM_FLOAT(50.0f)
+
+// Converts a duty % to a Q15 PWM duty
+#define PID_TO_DUTY(x) (PID_TO_Q16(x) / 200)
+
+// Max size of the yaw integral, in duty %
+#define YAW_I_LIMIT 60
+
+// PID controllers for the main and tail rotors
+static pidCtrl_t altPID;
+static pidCtrl_t yawPID;
+
+// Coupled controller for both rotors, an alternative to the PIDs
+static lqrCtrl_t lqr;
+
+// Output shaping of the main and tail rotor duties, and its limits in
+// duty % per second (squared) as Q16.16 parameters, 0 is no limit
+static shaper_t mainShaper;
+static shaper_t tailShaper;
+static int32_t mainSlew = Q16_FROM_FLOAT(100.0f);
+static int32_t mainAccel = Q16_FROM_FLOAT(2000.0f);
+static int32_t tailSlew = Q16_FROM_FLOAT(100.0f);
+static int32_t tailAccel = Q16_FROM_FLOAT(2000.0f);
+#define MAX_SLEW    Q16_FROM_FLOAT(1000.0f)
+#define MAX_ACCEL   Q16_FROM_FLOAT(20000.0f)
+
+#define MAX_STR_LEN 40
+
+// Controller in use, switchable at runtime for comparison
+enum controlModes {CONTROL_PID = 0, CONTROL_LQR};
+static int32_t controlMode = CONTROL_PID;
+// Set while each controller drives the rotors, so one coming in can take
+// over from what was applied
+static bool lqrActive = false;
+static bool altPIDActive = false;
+static bool yawPIDActive = false;
+
+// Reference trajectory limits, in % and degrees per second (squared)
+#define ALT_MAX_VELOCITY        PID_FROM_INT(40)
+#define ALT_MAX_ACCEL           PID_FROM_INT(80)
+#define ALT_LANDING_VELOCITY    PID_FROM_INT(10)
+#define YAW_MAX_VELOCITY        PID_FROM_INT(90)
+#define YAW_MAX_ACCEL           PID_FROM_INT(180)
+
+// Reference trajectories from the current to the target altitude and yaw
+static trajectory_t altTrajectory;
+static trajectory_t yawTrajectory;
+
+// Loops can be switched off while something else drives their rotor
+static bool altitudeControlEnabled = true;
+static bool yawControlEnabled = true;
+
+// Altitude gain band currently in use
+static uint8_t altGainBand = 0;
+
+// Feed-forward in use, in duty %
+static pidNum_t mainFeedForward = 0;
+static pidNum_t tailFeedForward = 0;
+
+// Control updates the heli must hold its targets before the
+// feed-forward tables learn from it, and the allowed errors
+#define STEADY_UPDATES      40
+#define STEADY_ALT_ERROR    1
+#define STEADY_YAW_ERROR    20
+static uint16_t steadyCount = 0;
+
+// Nominal and allowed range of the measured control interval, in us
+#define CONTROL_DT_NOMINAL  50000
+#define CONTROL_DT_MIN      100
+#define CONTROL_DT_MAX      100000
+
+// An interval this many times the average is a missed deadline, once
+// there are enough intervals for an average
+#define DEADLINE_FACTOR     2
+#define DEADLINE_SETTLE     16
+
+// Time step for PID, measured each control update
+static pidNum_t deltaT = PID_FROM_RATIO(CONTROL_DT_NOMINAL, 1000000);
+
+// Timestamp of the last control update
+static uint32_t lastControlTime;
+static bool controlTimed = false;
+
+// Statistics of the measured control interval
+static controlTiming_t timing;
+
+// Jitter moving average, times 16 so small deviations aren't lost
+static uint32_t jitterSum = 0;
+
+// Main rotor duty at a limit on the last update
+static bool mainSaturated = false;
+
+// Control either runs as a kernel task, or in sync with the ADC samples or
+// the PWM periods from a deferred interrupt.  Those interrupts pend the
+// unused ADC sequence 2 vector, which runs below the sensor interrupts but
+// ahead of the kernel.
+#define CONTROL_SYNC_INT        INT_ADC0SS2
+#define CONTROL_SYNC_PRIORITY   0x60
+enum controlSyncModes {SYNC_KERNEL = 0, SYNC_ADC, SYNC_PWM};
+#define MAX_SYNC_EVENTS         250
+static int32_t controlSync = SYNC_KERNEL;
+static int32_t syncSamples = 1;     // ADC samples or PWM periods per control cycle
+static uint8_t sampleCount = 0;
+static uint8_t lockDepth = 0;
+
+//
+// Holds off the synced control cycle while the kernel changes the state it
+// uses.  Nests, and costs nothing more than the interrupt mask otherwise.
+//
+void lockControl(void)
+{
+    IntDisable(CONTROL_SYNC_INT);
+    lockDepth++;
+}
+
+//
+// Lets the synced control cycle run again, once the outermost lock is
+// released.  A cycle pended while locked runs straight away.
+//
+void unlockControl(void)
+{
+    if (lockDepth > 0 && --lockDepth == 0) {
+        IntEnable(CONTROL_SYNC_INT);
+    }
+}
+
+//
+// Applies the gain parameters of the current band to the PIDs
+//
+static void applyGains(void)
+{
+    const gainBand_t *band = &altGainBands[altGainBand];
+
+    lockControl();
+    setPIDGains(&altPID, PID_FROM_Q16(band->kp), PID_FROM_Q16(band->ki), PID_FROM_Q16(band->kd));
+    setPIDGains(&yawPID, PID_FROM_Q16(yawKp), PID_FROM_Q16(yawKi), PID_FROM_Q16(yawKd));
+    unlockControl();
+}
+
+//
+// Applies the derivative parameters to the PIDs, and the filter cutoffs
+// to the LQR rates
+//
+static void applyDerivativeSettings(void)
+{
+    lockControl();
+    setPIDDerivativeOnMeasurement(&altPID, altDOnMeasurement);
+    setPIDDerivativeFilter(&altPID, PID_FROM_Q16(altDCutoff));
+    setPIDDerivativeOnMeasurement(&yawPID, yawDOnMeasurement);
+    setPIDDerivativeFilter(&yawPID, PID_FROM_Q16(yawDCutoff));
+
+    setLQRRateFilter(&lqr, LQR_ALT, PID_FROM_Q16(altDCutoff));
+    setLQRRateFilter(&lqr, LQR_YAW, PID_FROM_Q16(yawDCutoff));
+    unlockControl();
+}
+
+//
+// Applies the output shaping parameters
+//
+static void applyShaperLimits(void)
+{
+    lockControl();
+    setShaperLimits(&mainShaper, PID_FROM_Q16(mainSlew), PID_FROM_Q16(mainAccel));
+    setShaperLimits(&tailShaper, PID_FROM_Q16(tailSlew), PID_FROM_Q16(tailAccel));
+    unlockControl();
+}
+
+//
+// Prints how often the output shaping limited the rotors, or clears the
+// counts with "reset"
+//
+static void shaperCommand(char *args)
+{
+    char string[MAX_STR_LEN + 1];
+
+    if (strcmp(args, "reset") == 0) {
+        lockControl();
+        resetShaperStats(&mainShaper);
+        resetShaperStats(&tailShaper);
+        unlockControl();
+        UARTSend("shaper reset\r\n");
+        return;
+    }
+
+    usnprintf(string, sizeof(string), "main limited=%d/%d\r\n",
+              mainShaper.limited, mainShaper.updates);
+    UARTSend(string);
+    usnprintf(string, sizeof(string), "tail limited=%d/%d\r\n",
+              tailShaper.limited, tailShaper.updates);
+    UARTSend(string);
+}
+
+//
+// Registers the gains as parameters
+//
+static void registerGainParams(void)
+{
+    uint8_t band;
+
+    for (band = 0; band < NUM_ALT_GAIN_BANDS; band++) {
+        paramId_t id = (paramId_t)(PARAM_ALT_KP_LOW + band * 3);
+        registerParam(id, altGainNames[band][0], PARAM_FIXED, &altGainBands[band].kp,
+                      0, MAX_GAIN, applyGains);
+        registerParam(id + 1, altGainNames[band][1], PARAM_FIXED, &altGainBands[band].ki,
+                      0, MAX_GAIN, applyGains);
+        registerParam(id + 2, altGainNames[band][2], PARAM_FIXED, &altGainBands[band].kd,
+                      -MAX_GAIN, MAX_GAIN, applyGains);
+    }
+    registerParam(PARAM_YAW_KP, "yaw_kp", PARAM_FIXED, &yawKp, 0, MAX_GAIN, applyGains);
+    registerParam(PARAM_YAW_KI, "yaw_ki", PARAM_FIXED, &yawKi, 0, MAX_GAIN, applyGains);
+    registerParam(PARAM_YAW_KD, "yaw_kd", PARAM_FIXED, &yawKd, -MAX_GAIN, MAX_GAIN, applyGains);
+
+    registerParam(PARAM_ALT_D_MEAS, "alt_d_meas", PARAM_INT, &altDOnMeasurement,
+                  0, 1, applyDerivativeSettings);
+    registerParam(PARAM_ALT_D_CUTOFF, "alt_d_cutoff", PARAM_FIXED, &altDCutoff,
+                  0, MAX_D_CUTOFF, applyDerivativeSettings);
+    registerParam(PARAM_YAW_D_MEAS, "yaw_d_meas", PARAM_INT, &yawDOnMeasurement,
+                  0, 1, applyDerivativeSettings);
+    registerParam(PARAM_YAW_D_CUTOFF, "yaw_d_cutoff", PARAM_FIXED, &yawDCutoff,
+                  0, MAX_D_CUTOFF, applyDerivativeSettings);
+}
+
+//
+// Counts sync events, starting a control cycle every syncSamples events
+//
+static void countSyncEvent(void)
+{
+    sampleCount++;
+    if (sampleCount >= syncSamples) {
+        sampleCount = 0;
+        IntPendSet(CONTROL_SYNC_INT);
+    }
+}
 
 //
-// Resets the integrals for the yaw and altitude
+// Called from the ADC interrupt with each new sample
+//
+static void altitudeSampleHandler(void)
+{
+    if (controlSync == SYNC_ADC) {
+        countSyncEvent();
+    }
+}
+
+//
+// Called from the PWM interrupt at the start of each main rotor period.
+// Running control here keeps the duty updates the same time before the
+// boundary they are committed at.
+//
+static void pwmPeriodHandler(void)
+{
+    countSyncEvent();
+}
+
+//
+// Only takes the PWM period interrupt while control is synced to it
+//
+static void applyControlSync(void)
+{
+    setPWMPeriodHandler((controlSync == SYNC_PWM) ? pwmPeriodHandler : NULL);
+}
+
+//
+// Initialises the altitude and yaw PIDs
+//
+void initControl(void)
+{
+    initFeedForward();
+
+    initTrajectory(&altTrajectory, ALT_MAX_VELOCITY, ALT_MAX_ACCEL, 0, 0);
+    initTrajectory(&yawTrajectory, YAW_MAX_VELOCITY, YAW_MAX_ACCEL, PID_FROM_INT(360), 0);
+
+    altGainBand = 0;
+    initPID(&altPID, 0, 0, 0);
+    setPIDLimits(&altPID, PID_FROM_INT(MAIN_MIN_DUTY), PID_FROM_INT(MAX_DUTY));
+
+    initPID(&yawPID, 0, 0, 0);
+    setPIDLimits(&yawPID, PID_FROM_INT(TAIL_MIN_DUTY), PID_FROM_INT(MAX_TAIL_DUTY));
+    setPIDIntegralLimits(&yawPID, PID_FROM_INT(-YAW_I_LIMIT), PID_FROM_INT(YAW_I_LIMIT));
+    setPIDMeasurementWrap(&yawPID, PID_FROM_INT(360));
+
+    initLQR(&lqr);
+    setLQRIntegralLimit(&lqr, LQR_YAW, PID_FROM_INT(YAW_I_LIMIT));
+    setLQRMeasurementWrap(&lqr, LQR_YAW, PID_FROM_INT(360));
+
+    initShaper(&mainShaper, 0, 0);
+    initShaper(&tailShaper, 0, 0);
+
+    applyGains();
+    applyDerivativeSettings();
+    applyShaperLimits();
+    registerGainParams();
+
+    // Deferred interrupt for running control in sync with the ADC or PWM
+    IntRegister(CONTROL_SYNC_INT, controlSyncHandler);
+    IntPrioritySet(CONTROL_SYNC_INT, CONTROL_SYNC_PRIORITY);
+    IntEnable(CONTROL_SYNC_INT);
+    setAltitudeSampleHandler(altitudeSampleHandler);
+    applyControlSync();
+
+    registerParam(PARAM_CONTROL_SYNC, "control_sync", PARAM_INT, &controlSync,
+                  SYNC_KERNEL, SYNC_PWM, applyControlSync);
+    registerParam(PARAM_SYNC_SAMPLES, "sync_samples", PARAM_INT, &syncSamples,
+                  1, MAX_SYNC_EVENTS, NULL);
+    registerParam(PARAM_CONTROL_MODE, "control_mode", PARAM_INT, &controlMode,
+                  CONTROL_PID, CONTROL_LQR, NULL);
+
+    registerParam(PARAM_MAIN_SLEW, "main_slew", PARAM_FIXED, &mainSlew, 0, MAX_SLEW,
+                  applyShaperLimits);
+    registerParam(PARAM_MAIN_ACCEL, "main_accel", PARAM_FIXED, &mainAccel, 0, MAX_ACCEL,
+                  applyShaperLimits);
+    registerParam(PARAM_TAIL_SLEW, "tail_slew", PARAM_FIXED, &tailSlew, 0, MAX_SLEW,
+                  applyShaperLimits);
+    registerParam(PARAM_TAIL_ACCEL, "tail_accel", PARAM_FIXED, &tailAccel, 0, MAX_ACCEL,
+                  applyShaperLimits);
+    registerCommand("shaper", shaperCommand);
+}
+
+//
+// Resets the integrals for the yaw and altitude, and jumps their
+// references to the targets
 //
 void resetDI(void) {
-    prevYawI = 0;
-    prevAltI = 0;
+    lockControl();
+    resetYawDI();
+    resetPIDIntegral(&altPID);
+    resetLQRIntegral(&lqr, LQR_ALT);
+    resetTrajectory(&altTrajectory, PID_FROM_INT(getTargetAltitude()));
+    unlockControl();
 }
 
 //
-// Resets the yaw derivative 
+// Resets the yaw integral and jumps the yaw reference to the target
 //
 void resetYawDI(void) {
-    prevYawI = 0;
+    lockControl();
+    resetPIDIntegral(&yawPID);
+    resetLQRIntegral(&lqr, LQR_YAW);
+    resetTrajectory(&yawTrajectory, PID_FROM_INT(getTargetYaw()) / 10);
+    unlockControl();
+}
+
+//
+// Checks if the altitude reference has reached the target altitude
+//
+bool isAltitudeTrajectoryDone(void)
+{
+    return isTrajectoryDone(&altTrajectory);
+}
+
+//
+// Gets the current yaw integral, in duty %
+//
+int32_t getYI(void)
+{
+    return PID_TO_INT(yawPID.integral);
+}
+
+//
+// Gets the current altitude integral, in duty %
+//
+int32_t getAI(void)
+{
+    return PID_TO_INT(altPID.integral);
+}
+
+//
+// Selects the altitude PID gains for the band containing the target altitude
+//
+void scheduleAltitudeGains(int32_t targetAltitude)
+{
+    uint8_t band = 0;
+
+    while (band + 1 < NUM_ALT_GAIN_BANDS && targetAltitude >= altGainBands[band + 1].minAltitude) {
+        band++;
+    }
+
+    if (band != altGainBand) {
+        altGainBand = band;
+        applyGains();
+    }
+}
+
+//
+// Replaces the altitude PID gains of the band the heli is flying in
+//
+void setAltitudeGains(pidNum_t kp, pidNum_t ki, pidNum_t kd)
+{
+    lockControl();
+    altGainBands[altGainBand].kp = PID_TO_Q16(kp);
+    altGainBands[altGainBand].ki = PID_TO_Q16(ki);
+    altGainBands[altGainBand].kd = PID_TO_Q16(kd);
+    applyGains();
+    unlockControl();
 }
 
 //
-// Gets the current prevYawI 
+// Replaces the yaw PID gains
 //
-float getYI(void)
+void setYawGains(pidNum_t kp, pidNum_t ki, pidNum_t kd)
 {
-    return prevYawI;
+    lockControl();
+    yawKp = PID_TO_Q16(kp);
+    yawKi = PID_TO_Q16(ki);
+    yawKd = PID_TO_Q16(kd);
+    applyGains();
+    unlockControl();
+}
+
+//
+// Enables or disables the altitude PID driving the main rotor
+//
+void setAltitudeControlEnabled(bool enable)
+{
+    altitudeControlEnabled = enable;
+}
+
+//
+// Enables or disables the yaw PID driving the tail rotor
+//
+void setYawControlEnabled(bool enable)
+{
+    yawControlEnabled = enable;
+}
+
+//
+// Learns the feed-forward tables once the heli has held its targets for
+// a while.  The integrals are shifted by the change in feed-forward so the
+// rotor duties don't jump, so it only runs under the PIDs.
+//
+void updateFeedForwardLearning(void)
+{
+    if (controlMode != CONTROL_PID || getHeliState() != FLYING || abs(getAltitudeError()) > STEADY_ALT_ERROR
+            || abs(getYawError()) > STEADY_YAW_ERROR) {
+        steadyCount = 0;
+        return;
+    }
+
+    if (steadyCount < STEADY_UPDATES) {
+        steadyCount++;
+        return;
+    }
+
+    pidNum_t target = PID_FROM_INT(getTargetAltitude());
+    pidNum_t mainDuty = mainFeedForward + altPID.output;
+    pidNum_t tailDuty = tailFeedForward + yawPID.output;
+
+    learnFeedForward(target, mainDuty, tailDuty, deltaT);
+
+    adjustPIDIntegral(&altPID, mainFeedForward - getHoverFeedForward(target));
+    adjustPIDIntegral(&yawPID, tailFeedForward - getTailFeedForward(mainDuty));
+}
+
+//
+// Moves the altitude reference towards the target and updates the hover
+// feed-forward, returns the reference
+//
+static pidNum_t updateAltitudeReference(int32_t target)
+{
+    scheduleAltitudeGains(target);
+
+    // Moves the reference towards the target, slower when landing
+    setTrajectoryMaxVelocity(&altTrajectory,
+                             getHeliState() == LANDING ? ALT_LANDING_VELOCITY : ALT_MAX_VELOCITY);
+    setTrajectoryTarget(&altTrajectory, PID_FROM_INT(target));
+    pidNum_t reference = updateTrajectory(&altTrajectory, deltaT);
+
+    mainFeedForward = getHoverFeedForward(reference);
+    return reference;
+}
+
+//
+// Moves the yaw reference towards the target, returns the reference
+//
+static pidNum_t updateYawReference(void)
+{
+    setTrajectoryTarget(&yawTrajectory, PID_FROM_INT(getTargetYaw()) / 10);
+    return updateTrajectory(&yawTrajectory, deltaT);
+}
+
+//
+// Wraps a yaw error to +/- 180 degrees
+//
+static pidNum_t wrapYawError(pidNum_t error)
+{
+    if (error > PID_FROM_INT(180)) {
+        error -= PID_FROM_INT(360);
+    } else if (error < PID_FROM_INT(-180)) {
+        error += PID_FROM_INT(360);
+    }
+    return error;
+}
+
+//
+// Gets the main rotor's duty range for this update, the duty limits
+// narrowed by the output shaping
+//
+static void getMainDutyRange(pidNum_t *min, pidNum_t *max)
+{
+    *min = PID_FROM_INT(MAIN_MIN_DUTY);
+    *max = PID_FROM_INT(MAX_DUTY);
+    limitShaperRange(&mainShaper, deltaT, min, max);
+}
+
+//
+// Gets the tail rotor's duty range for this update, the duty limits
+// narrowed by the output shaping
+//
+static void getTailDutyRange(pidNum_t *min, pidNum_t *max)
+{
+    *min = PID_FROM_INT(TAIL_MIN_DUTY);
+    *max = PID_FROM_INT(MAX_TAIL_DUTY);
+    limitShaperRange(&tailShaper, deltaT, min, max);
+}
+
+//
+// Triggers the recorder as the main rotor's duty reaches its limits
+//
+static void checkMainSaturation(pidNum_t control)
+{
+    bool saturated = control <= PID_FROM_INT(MAIN_MIN_DUTY) || control >= PID_FROM_INT(MAX_DUTY);
+
+    if (saturated && !mainSaturated) {
+        triggerRecorder(REC_TRIGGER_SATURATION);
+    }
+    mainSaturated = saturated;
 }
 
 //
@@ -67,24 +608,25 @@ float getYI(void)
 //
 void updateAltitudeControl(void)
 {
-    float error = getAltitudeError();
-    float P = ALT_KP * error;
-    float dI = ALT_KI * error * deltaT;
-    float D = ALT_KD * ((error - prevAltError) / deltaT);
+    int32_t target = getTargetAltitude();
+    pidNum_t altitude = PID_FROM_INT(target - getAltitudeError());
 
-    float control = P + (prevAltI + dI) + D;
+    pidNum_t reference = updateAltitudeReference(target);
+    setPIDRateReference(&altPID, altTrajectory.velocity);
 
-    // Checks saturation of control and the integral
-    if(control > MAX_DUTY && error > 0) {
-        control = MAX_DUTY;
-    } else if (control < MAIN_MIN_DUTY && error < 0) {
-        control = MAIN_MIN_DUTY;
-    } else {
-        prevAltI = (prevAltI + dI);
-    }
+    // The PID only trims around the hover duty, so its limits move with it.
+    // Shaping shows up as output limits so the anti-windup accounts for it.
+    pidNum_t dutyMin, dutyMax;
+    getMainDutyRange(&dutyMin, &dutyMax);
+    setPIDLimits(&altPID, dutyMin - mainFeedForward, dutyMax - mainFeedForward);
 
-    prevAltError = error;
-    setMainPower((int32_t)(control));
+    pidNum_t control = mainFeedForward
+            + updatePID(&altPID, reference - altitude, altitude, deltaT);
+    markLatency(LAT_ALT_PID);
+
+    checkMainSaturation(control);
+    setMainDuty(PID_TO_DUTY(control));
+    updateShaper(&mainShaper, control, deltaT);
 }
 
 //
@@ -92,44 +634,247 @@ void updateAltitudeControl(void)
 //
 void updateYawControl(void)
 {
-    static float previousYaw = 0;
-    int16_t tempYaw = getCurrentYaw();
-    float currentYaw = (float)(tempYaw) / 10;
-    int16_t tempTargetYaw = getTargetYaw();
-    float targetYaw = (float)(tempTargetYaw) / 10;
-    float error = getYawError2(targetYaw, currentYaw);
-    float P = YAW_KP * error;
-    float dI = YAW_KI * error * deltaT;
+    // Yaw is in tenths of a degree
+    pidNum_t currentYaw = PID_FROM_INT(getCurrentYaw()) / 10;
+
+    pidNum_t reference = updateYawReference();
+    setPIDRateReference(&yawPID, yawTrajectory.velocity);
+    pidNum_t error = wrapYawError(reference - currentYaw);
+
+    // Cancels the main rotor's torque before it shows up as yaw error
+    tailFeedForward = getTailFeedForward(mainFeedForward + altPID.output);
+    pidNum_t dutyMin, dutyMax;
+    getTailDutyRange(&dutyMin, &dutyMax);
+    setPIDLimits(&yawPID, dutyMin - tailFeedForward, dutyMax - tailFeedForward);
+
+    pidNum_t control = tailFeedForward + updatePID(&yawPID, error, currentYaw, deltaT);
+    markLatency(LAT_YAW_PID);
+
+    updateYawBuff(); // Update the yaw buffer
+    setTailDuty(PID_TO_DUTY(control));
+    updateShaper(&tailShaper, control, deltaT);
+}
+
+//
+// Updates both rotors' duty cycles together with the LQR
+//
+void updateCoupledControl(void)
+{
+    pidNum_t error[LQR_AXES];
+    pidNum_t measurement[LQR_AXES];
+    pidNum_t rateRef[LQR_AXES];
+    int32_t target = getTargetAltitude();
+
+    measurement[LQR_ALT] = PID_FROM_INT(target - getAltitudeError());
+    error[LQR_ALT] = updateAltitudeReference(target) - measurement[LQR_ALT];
+    rateRef[LQR_ALT] = altTrajectory.velocity;
+
+    // Yaw is in tenths of a degree
+    measurement[LQR_YAW] = PID_FROM_INT(getCurrentYaw()) / 10;
+    error[LQR_YAW] = wrapYawError(updateYawReference() - measurement[LQR_YAW]);
+    rateRef[LQR_YAW] = yawTrajectory.velocity;
 
-    if(prevYawI > 60) {
-        prevYawI = 60;
+    // The feed-forward covers the steady torque, the gains the rest
+    tailFeedForward = getTailFeedForward(mainFeedForward + lqr.output[LQR_ALT]);
+    pidNum_t dutyMin, dutyMax;
+    getMainDutyRange(&dutyMin, &dutyMax);
+    setLQRLimits(&lqr, LQR_ALT, dutyMin - mainFeedForward, dutyMax - mainFeedForward);
+    getTailDutyRange(&dutyMin, &dutyMax);
+    setLQRLimits(&lqr, LQR_YAW, dutyMin - tailFeedForward, dutyMax - tailFeedForward);
+
+    updateLQR(&lqr, error, measurement, rateRef, deltaT);
+    markLatency(LAT_ALT_PID);
+    markLatency(LAT_YAW_PID);
+
+    pidNum_t mainControl = mainFeedForward + lqr.output[LQR_ALT];
+    pidNum_t tailControl = tailFeedForward + lqr.output[LQR_YAW];
+    checkMainSaturation(mainControl);
+    setMainDuty(PID_TO_DUTY(mainControl));
+    updateShaper(&mainShaper, mainControl, deltaT);
+
+    updateYawBuff(); // Update the yaw buffer
+    setTailDuty(PID_TO_DUTY(tailControl));
+    updateShaper(&tailShaper, tailControl, deltaT);
+}
+
+//
+// Measures the time since the last control update and updates deltaT
+// and the interval statistics
+//
+void updateDeltaT(void)
+{
+    uint32_t now = getTimestamp();
+
+    // No interval on the first update, use the nominal time step
+    if (!controlTimed) {
+        lastControlTime = now;
+        controlTimed = true;
+        return;
     }
 
-    float D = YAW_KD * (previousYaw - currentYaw) / deltaT;
-    float control = P + (prevYawI + dI) + D;
+    uint32_t dtUs = ticksToMicros(now - lastControlTime);
+    lastControlTime = now;
+
+    // An update well after the usual interval missed its deadline
+    if (timing.count >= DEADLINE_SETTLE && dtUs > timing.meanUs * DEADLINE_FACTOR) {
+        triggerRecorder(REC_TRIGGER_DEADLINE);
+    }
 
-    // Checks saturation of control and the integral
-    if(control > MAX_DUTY && error > 0) {
-        control = MAX_DUTY;
-    } else if (control < TAIL_MIN_DUTY && error < 0) {
-        control = TAIL_MIN_DUTY;
+    // Records the interval statistics
+    if (timing.count == 0 || dtUs < timing.minUs) {
+        timing.minUs = dtUs;
+    }
+    if (dtUs > timing.maxUs) {
+        timing.maxUs = dtUs;
+    }
+    if (timing.count == 0) {
+        timing.meanUs = dtUs;
     } else {
-        prevYawI = (prevYawI + dI);
+        // Jitter over about the last 16 intervals, as in RFC 3550
+        jitterSum += abs((int32_t)dtUs - (int32_t)timing.meanUs) - jitterSum / 16;
+        timing.jitterUs = jitterSum / 16;
+        timing.meanUs += ((int32_t)dtUs - (int32_t)timing.meanUs) / 16; // Moving average
     }
-    previousYaw = currentYaw;
+    timing.lastUs = dtUs;
+    timing.count++;
 
+    // Bounds the time step so a stalled loop can't blow up the I and D terms
+    if (dtUs > CONTROL_DT_MAX) {
+        dtUs = CONTROL_DT_MAX;
+        timing.overruns++;
+    } else if (dtUs < CONTROL_DT_MIN) {
+        dtUs = CONTROL_DT_MIN;
+    }
+    deltaT = PID_FROM_RATIO(dtUs, 1000000);
+}
 
+//
+// Gets the statistics of the measured control interval
+//
+void getControlTiming(controlTiming_t *stats)
+{
+    *stats = timing;
+}
 
-    updateYawBuff(); // Update the yaw buffer
-    setTailPower((int32_t)(control));
+//
+// Clears the control interval statistics
+//
+void resetControlTiming(void)
+{
+    timing.lastUs = 0;
+    timing.minUs = 0;
+    timing.maxUs = 0;
+    timing.meanUs = 0;
+    timing.jitterUs = 0;
+    jitterSum = 0;
+    timing.count = 0;
+    timing.overruns = 0;
 }
 
 //
-// Updates main and tail motors PIDs
+// Gets the duty being applied to a rotor, in %
+//
+static pidNum_t getAppliedDuty(int32_t duty)
+{
+    return PID_FROM_RATIO(duty * 100, PWM_DUTY_ONE);
+}
+
+//
+// Gets what a controller coming in has to take over from: the duty already
+// applied less the feed-forward, and the current errors and measurements
+//
+static void getHandover(pidNum_t output[LQR_AXES], pidNum_t error[LQR_AXES],
+                        pidNum_t measurement[LQR_AXES])
+{
+    measurement[LQR_ALT] = PID_FROM_INT(getTargetAltitude() - getAltitudeError());
+    error[LQR_ALT] = altTrajectory.position - measurement[LQR_ALT];
+    output[LQR_ALT] = getAppliedDuty(getMainDuty()) - mainFeedForward;
+
+    // Yaw is in tenths of a degree
+    measurement[LQR_YAW] = PID_FROM_INT(getCurrentYaw()) / 10;
+    error[LQR_YAW] = wrapYawError(yawTrajectory.position - measurement[LQR_YAW]);
+    output[LQR_YAW] = getAppliedDuty(getTailDuty()) - tailFeedForward;
+}
+
+//
+// Primes the controllers that weren't driving the rotors last cycle, so a
+// mode switch or a loop coming back on doesn't bump the rotors
+//
+static void handOverControl(bool useLQR, bool useAltPID, bool useYawPID)
+{
+    pidNum_t output[LQR_AXES];
+    pidNum_t error[LQR_AXES];
+    pidNum_t measurement[LQR_AXES];
+
+    if ((useLQR && !lqrActive) || (useAltPID && !altPIDActive)
+            || (useYawPID && !yawPIDActive)) {
+        getHandover(output, error, measurement);
+        if (useLQR && !lqrActive) {
+            primeLQR(&lqr, output, error, measurement);
+        }
+        if (useAltPID && !altPIDActive) {
+            primePID(&altPID, output[LQR_ALT], error[LQR_ALT], measurement[LQR_ALT]);
+        }
+        if (useYawPID && !yawPIDActive) {
+            primePID(&yawPID, output[LQR_YAW], error[LQR_YAW], measurement[LQR_YAW]);
+        }
+    }
+    lqrActive = useLQR;
+    altPIDActive = useAltPID;
+    yawPIDActive = useYawPID;
+}
+
+//
+// Runs one control cycle, from the latest sensor data to the rotors
+//
+static void runControlCycle(void)
+{
+    markLatency(LAT_CONTROL_START);
+    updateAltitude();
+    updateDeltaT();
+    beginPWMUpdate();
+
+    // The LQR needs both rotors, otherwise the PIDs run whatever loops
+    // are enabled.  Switching is done here so it can't split a cycle.
+    bool useLQR = controlMode == CONTROL_LQR && altitudeControlEnabled && yawControlEnabled;
+    handOverControl(useLQR, !useLQR && altitudeControlEnabled, !useLQR && yawControlEnabled);
+
+    if (useLQR) {
+        updateCoupledControl();
+    } else {
+        // Altitude first so the tail feed-forward sees the new main duty
+        if (altitudeControlEnabled) {
+            updateAltitudeControl();
+        } else {
+            // Follows whatever is driving the rotor so shaping picks up from it
+            updateShaper(&mainShaper, getAppliedDuty(getMainDuty()), deltaT);
+        }
+        if (yawControlEnabled) {
+            updateYawControl();
+        } else {
+            updateShaper(&tailShaper, getAppliedDuty(getTailDuty()), deltaT);
+        }
+    }
+    commitPWMUpdate();
+    updateFeedForwardLearning();
+    recordSample();
+}
+
+//
+// Updates main and tail motors PIDs, unless they run in sync with the ADC
+// or PWM
 //
 void updateControl(void)
 {
-    updateYawControl();
-    updateAltitudeControl(); 
+    if (controlSync == SYNC_KERNEL) {
+        runControlCycle();
+    }
 }
 
+//
+// Deferred interrupt handler that runs control in sync with the ADC or PWM
+//
+void controlSyncHandler(void)
+{
+    runControlCycle();
+}
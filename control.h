@@ -3,7 +3,7 @@
 // control.h - Module for controlling the helicopter's motors with PID
 //
 // Author:  bma206, tki36
-// Last modified:   12.5.2024
+// Last modified:   19.10.2026
 //
 //*****************************************************************************
 
@@ -11,25 +11,103 @@
 #define CONTROL_H_
 
 #include <stdint.h>
+#include <stdbool.h>
+#include "pid.h"
 
 //
-// Resets the integrals for the yaw and altitude
+// Statistics of the measured control interval, in us
+//
+typedef struct {
+    uint32_t lastUs;
+    uint32_t minUs;
+    uint32_t maxUs;
+    uint32_t meanUs;        // Moving average
+    uint32_t jitterUs;      // Moving average of the distance from the mean
+    uint32_t count;         // Number of intervals measured
+    uint32_t overruns;      // Intervals longer than the allowed max
+} controlTiming_t;
+
+//
+// Initialises the altitude and yaw PIDs
+//
+void initControl(void);
+
+//
+// Holds off control running in sync with the ADC or PWM while the kernel
+// changes several things it uses.  Locks nest.
+//
+void lockControl(void);
+
+//
+// Lets synced control run again once the outermost lock is released
+//
+void unlockControl(void);
+
+//
+// Resets the integrals for the yaw and altitude, and jumps their
+// references to the targets
 //
 void resetDI(void);
 
 //
-// Gets the current prevYawI 
+// Gets the current yaw integral, in duty %
+//
+int32_t getYI(void);
+
+//
+// Gets the current altitude integral, in duty %
 //
-float getYI(void);
+int32_t getAI(void);
 
 //
-// Resets the yaw derivative 
+// Resets the yaw integral and jumps the yaw reference to the target
 //
 void resetYawDI(void);
 
 //
-// Updates main and tail motors
+// Checks if the altitude reference has reached the target altitude
+//
+bool isAltitudeTrajectoryDone(void);
+
+//
+// Replaces the altitude PID gains of the band the heli is flying in
+//
+void setAltitudeGains(pidNum_t kp, pidNum_t ki, pidNum_t kd);
+
+//
+// Replaces the yaw PID gains
+//
+void setYawGains(pidNum_t kp, pidNum_t ki, pidNum_t kd);
+
+//
+// Enables or disables the altitude PID driving the main rotor
+//
+void setAltitudeControlEnabled(bool enable);
+
+//
+// Enables or disables the yaw PID driving the tail rotor
+//
+void setYawControlEnabled(bool enable);
+
+//
+// Updates main and tail motors, unless they run in sync with the ADC or
+// PWM
 //
 void updateControl(void);
 
+//
+// Deferred interrupt handler that runs control in sync with the ADC or PWM
+//
+void controlSyncHandler(void);
+
+//
+// Gets the statistics of the measured control interval
+//
+void getControlTiming(controlTiming_t *stats);
+
+//
+// Clears the control interval statistics
+//
+void resetControlTiming(void);
+
 #endif /*CONTROL_H_*/
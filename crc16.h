@@ -0,0 +1,28 @@
+//*****************************************************************************
+//
+// crc16.h - CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) used to check
+// telemetry frames.  No hardware dependencies, so host tools can build it.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#ifndef CRC16_H_
+#define CRC16_H_
+
+#include <stdint.h>
+
+#define CRC16_INIT 0xFFFF
+
+//
+// Continues a CRC over more data, start with CRC16_INIT
+//
+uint16_t updateCRC16(uint16_t crc, const uint8_t *data, uint16_t len);
+
+//
+// Gets the CRC of a block of data
+//
+uint16_t getCRC16(const uint8_t *data, uint16_t len);
+
+#endif /*CRC16_H_*/
@@ -1,19 +1,29 @@
 //*****************************************************************************
 //
 // display.c - Controls the screen for outputing the relevant information
-// of the heli  
+// of the heli.  The text on the screen is kept in a shadow buffer, and
+// only the part of a line that changed is drawn, at most DISPLAY_RATE_HZ
+// times a second.  Drawing goes to the OLED framebuffer and is sent in
+// the background by the OLED driver.
+//
+// Graph mode (display_mode = 1) plots the altitude against its target on
+// the top half of the screen, and the yaw error on the bottom half.  Each
+// column is a span of GRAPH_COLUMN_HZ, showing the min to max of the
+// values seen in it.  The plot sweeps across the screen one column per
+// update, leaving a gap ahead of the newest column, so each update only
+// sends a couple of columns.  The columns are also kept in a history, so
+// switching to graph mode shows the recent past straight away.
 //
 // Author:  bma206, tki36
-// Last modified:   21.5.2024
+// Last modified:   19.10.2026
 //
 //*****************************************************************************
 
-#include "OrbitOLED/OrbitOLEDInterface.h"
 #include "display.h"
 #include "altitude.h"
 #include <stdint.h>
-#include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include "inc/hw_memmap.h"
 #include "inc/hw_types.h"
 #include "driverlib/adc.h"
@@ -24,31 +34,77 @@
 #include "driverlib/interrupt.h"
 #include "driverlib/debug.h"
 #include "utils/ustdlib.h"
-#include "OrbitOled/lib_OrbitOled/OrbitOled.h"
+#include "oled.h"
 #include "yaw.h"
 #include "pwm.h"
+#include "timer.h"
+#include "params.h"
+
+// Size of the screen in characters
+#define DISPLAY_ROWS OLED_TEXT_ROWS
+#define DISPLAY_COLS OLED_TEXT_COLS
+
+// Max screen updates per second, faster isn't readable
+#define DISPLAY_RATE_HZ 10
+
+// Text on the screen, and the text for the next update
+static char shownText[DISPLAY_ROWS][DISPLAY_COLS];
+static char newText[DISPLAY_ROWS][DISPLAY_COLS];
 
+// Time of the last screen update
+static uint32_t lastDisplayTime;
 
+// Display modes, set as a parameter
+enum displayModes {DISPLAY_TEXT = 0, DISPLAY_GRAPH};
+static int32_t displayMode = DISPLAY_TEXT;
+static uint8_t shownMode = DISPLAY_TEXT;
+
+// Graph columns per second, and the yaw error at the edges of its plot
+// in tenths of a degree
+#define GRAPH_COLUMN_HZ     20
+#define GRAPH_YAW_RANGE     300
+
+// Plot areas, the top pixel row and the rows below it, with a blank row
+// between them
+#define GRAPH_ALT_TOP       0
+#define GRAPH_ALT_HEIGHT    14
+#define GRAPH_YAW_TOP       16
+#define GRAPH_YAW_HEIGHT    15
 
 //
-// Altiude as different value types
-// for the display output use only!
+// A graph column, the ranges of the values over its span
 //
-int16_t altitudePercentage;
-int16_t altitude;
-int16_t baseAltitude;
-uint32_t mainDuty;
-uint32_t tailDuty;
+typedef struct {
+    int16_t altMin;
+    int16_t altMax;
+    int16_t altTarget;
+    int16_t yawMin;         // Yaw error, tenths of a degree
+    int16_t yawMax;
+} graphColumn_t;
 
-// Current yaw
-int16_t currentYaw = 0;
+// Column being collected, the history of the finished ones and the next
+// screen column to draw
+static graphColumn_t column;
+static bool columnStarted = false;
+static graphColumn_t history[OLED_WIDTH];
+static uint8_t historyCount = 0;
+static uint8_t graphX = 0;
+static uint32_t lastColumnTime;
 
 //
 // intialise the Orbit OLED display
 //
 void initDisplay (void)
 {
-    OLEDInitialise ();
+    initOLED();
+
+    // The screen starts blank
+    memset(shownText, ' ', sizeof(shownText));
+    lastDisplayTime = getTimestamp();
+    lastColumnTime = lastDisplayTime;
+
+    registerParam(PARAM_DISPLAY_MODE, "display_mode", PARAM_INT, &displayMode,
+                  DISPLAY_TEXT, DISPLAY_GRAPH, NULL);
 }
 
 //
@@ -56,45 +112,233 @@ void initDisplay (void)
 //
 void clearDisplay(void)
 {
-    OrbitOledClear();
+    clearOLED();
+    memset(shownText, ' ', sizeof(shownText));
 }
 
+//
+// Sets the text of a line for the next update, padded with spaces
+//
+static void setLine(uint8_t row, const char *string)
+{
+    uint8_t len = strlen(string);
+
+    if (len > DISPLAY_COLS) {
+        len = DISPLAY_COLS;
+    }
+    memcpy(newText[row], string, len);
+    memset(&newText[row][len], ' ', DISPLAY_COLS - len);
+}
+
+//
+// Draws the part of a line that changed since it was last drawn
+//
+static void drawChanges(uint8_t row)
+{
+    char string[DISPLAY_COLS + 1];
+    uint8_t first = 0;
+    uint8_t last = DISPLAY_COLS;
+
+    while (first < DISPLAY_COLS && newText[row][first] == shownText[row][first]) {
+        first++;
+    }
+    if (first == DISPLAY_COLS) {
+        return;
+    }
+    while (newText[row][last - 1] == shownText[row][last - 1]) {
+        last--;
+    }
+
+    memcpy(string, &newText[row][first], last - first);
+    string[last - first] = '\0';
+    drawOLEDString(string, first, row);
+    memcpy(&shownText[row][first], string, last - first);
+}
 
 //
-// Displays the current altitude as a percentage of the maximum altitude using an ADC value
+// Sets the lines for the altitude percentage, yaw and rotor duties
 //
-void displayPerVal(int16_t perValue, int16_t yawValue, uint32_t tailDuty, uint32_t mainDuty)
+static void displayPerVal(int16_t perValue, int16_t yawValue, uint32_t tailDuty, uint32_t mainDuty)
 {
-    char string[17];  // 16 characters across the display
+    char string[DISPLAY_COLS + 1];
 
     // Form a new string for the line.  The maximum width specified for the
     //  number field ensures it is displayed right justified.
     usnprintf (string, sizeof(string), "Alt = %4d%%", perValue);
-    OLEDStringDraw (string, 0, 0);
+    setLine(0, string);
 
     usnprintf (string, sizeof(string), "YAW = %4d.%d", yawValue/10, abs(yawValue%10));
-    OLEDStringDraw (string, 0, 1);
+    setLine(1, string);
 
     usnprintf (string, sizeof(string), "Main duty = %3d%%", mainDuty);
-    OLEDStringDraw (string, 0, 2);
+    setLine(2, string);
 
     usnprintf (string, sizeof(string), "Tail duty = %3d%%", tailDuty);
-    OLEDStringDraw (string, 0, 3);
+    setLine(3, string);
 }
 
 
 //
-// Updates/outputs the display
+// Adds a value to a range, starting it if it is the first
+//
+static void widenRange(int16_t *min, int16_t *max, int16_t value, bool first)
+{
+    if (first || value < *min) {
+        *min = value;
+    }
+    if (first || value > *max) {
+        *max = value;
+    }
+}
+
+//
+// Adds the current values to the column being collected
+//
+static void sampleGraph(void)
+{
+    int16_t altitude = getMeasuredAltitude();
+    int16_t yawError = getYawError();
+
+    widenRange(&column.altMin, &column.altMax, altitude, !columnStarted);
+    widenRange(&column.yawMin, &column.yawMax, yawError, !columnStarted);
+    column.altTarget = getTargetAltitude();
+    columnStarted = true;
+}
+
+//
+// Scales a value to a pixel row of a plot, the top row is max
+//
+static uint8_t scaleToRow(int32_t value, int32_t min, int32_t max, uint8_t top, uint8_t height)
+{
+    if (value < min) {
+        value = min;
+    } else if (value > max) {
+        value = max;
+    }
+    return top + height - (value - min) * height / (max - min);
+}
+
+//
+// Sets the pixel rows between two rows of a column, bit 0 is the top row
+//
+static uint32_t pixelSpan(uint8_t row1, uint8_t row2)
+{
+    uint8_t top = (row1 < row2) ? row1 : row2;
+    uint8_t bottom = (row1 < row2) ? row2 : row1;
+
+    return (0xFFFFFFFFUL >> (31 - bottom + top)) << top;
+}
+
+//
+// Gets the pixels of a graph column, and draws them at x
+//
+static void drawGraphColumn(uint8_t x, const graphColumn_t *col)
+{
+    uint32_t pixels = 0;
+    uint8_t page;
+
+    // Altitude range, with the target as a dotted line
+    pixels |= pixelSpan(scaleToRow(col->altMin, 0, 100, GRAPH_ALT_TOP, GRAPH_ALT_HEIGHT),
+                        scaleToRow(col->altMax, 0, 100, GRAPH_ALT_TOP, GRAPH_ALT_HEIGHT));
+    if (x % 2 == 0) {
+        pixels |= 1UL << scaleToRow(col->altTarget, 0, 100, GRAPH_ALT_TOP, GRAPH_ALT_HEIGHT);
+    }
+
+    // Yaw error range, with zero as a dotted line
+    pixels |= pixelSpan(scaleToRow(col->yawMin, -GRAPH_YAW_RANGE, GRAPH_YAW_RANGE,
+                                   GRAPH_YAW_TOP, GRAPH_YAW_HEIGHT),
+                        scaleToRow(col->yawMax, -GRAPH_YAW_RANGE, GRAPH_YAW_RANGE,
+                                   GRAPH_YAW_TOP, GRAPH_YAW_HEIGHT));
+    if (x % 2 == 0) {
+        pixels |= 1UL << scaleToRow(0, -GRAPH_YAW_RANGE, GRAPH_YAW_RANGE,
+                                    GRAPH_YAW_TOP, GRAPH_YAW_HEIGHT);
+    }
+
+    for (page = 0; page < OLED_PAGES; page++) {
+        setOLEDColumn(x, page, pixels >> (8 * page));
+    }
+}
+
+//
+// Blanks a column of the screen
+//
+static void clearGraphColumn(uint8_t x)
+{
+    uint8_t page;
+
+    for (page = 0; page < OLED_PAGES; page++) {
+        setOLEDColumn(x, page, 0);
+    }
+}
+
+//
+// Ends the column being collected, adds it to the history and draws it
+// if the graph is showing
+//
+static void addGraphColumn(void)
+{
+    history[graphX] = column;
+    if (historyCount < OLED_WIDTH) {
+        historyCount++;
+    }
+    columnStarted = false;
+
+    if (shownMode == DISPLAY_GRAPH) {
+        drawGraphColumn(graphX, &history[graphX]);
+        clearGraphColumn((graphX + 1) % OLED_WIDTH);
+    }
+    graphX = (graphX + 1) % OLED_WIDTH;
+}
+
+//
+// Clears the screen and draws the mode being switched to in full, the
+// text from scratch or the graph from its history
+//
+static void switchDisplayMode(void)
+{
+    uint8_t i;
+
+    clearOLED();
+    memset(shownText, ' ', sizeof(shownText));
+    shownMode = displayMode;
+
+    if (shownMode == DISPLAY_GRAPH) {
+        // The history is kept at the screen column it was drawn at
+        for (i = 0; i < historyCount; i++) {
+            uint8_t x = (graphX + OLED_WIDTH - historyCount + i) % OLED_WIDTH;
+            drawGraphColumn(x, &history[x]);
+        }
+    }
+}
+
+//
+// Updates/outputs the display, when an update is due
 //
 void updateDisplay(void)
 {
-    // Gets the values to display
-    altitude = getAltitudeADC();
-    currentYaw = getCurrentYaw();
-    mainDuty = getMainPower();
-    tailDuty = getTailPower();
-
-    // Display altitude as a percentage
-    getAltitudePercentage(altitude, &altitudePercentage);
-    displayPerVal (altitudePercentage, currentYaw, tailDuty, mainDuty);
+    uint32_t now = getTimestamp();
+    uint8_t row;
+
+    // The graph collects every pass, so columns show the full range
+    sampleGraph();
+    if (now - lastColumnTime >= getTimerFrequency() / GRAPH_COLUMN_HZ) {
+        lastColumnTime = now;
+        addGraphColumn();
+    }
+
+    if (displayMode != shownMode) {
+        switchDisplayMode();
+    }
+
+    if (shownMode == DISPLAY_TEXT && now - lastDisplayTime >= getTimerFrequency() / DISPLAY_RATE_HZ) {
+        lastDisplayTime = now;
+
+        // The altitude from the last control update, rather than reading the ADC
+        displayPerVal(getMeasuredAltitude(), getCurrentYaw(), getTailPower(), getMainPower());
+
+        for (row = 0; row < DISPLAY_ROWS; row++) {
+            drawChanges(row);
+        }
+    }
+    flushOLED();
 }
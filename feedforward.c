@@ -0,0 +1,120 @@
+//*****************************************************************************
+//
+// feedforward.c - Feed-forward tables for the main and tail rotors.
+// Hover duty is looked up from the target altitude and the tail duty
+// from the main rotor duty, so the PID integrators only trim residuals.
+// The tables fill themselves from steady state hover samples, and are
+// parameters so a learned table can be saved with the others.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lookup.h"
+#include "params.h"
+#include "control.h"
+#include "feedforward.h"
+
+// Breakpoint spacing, altitude % for hover and duty % for the tail
+#define FF_STEP 10
+#define FF_POINTS 11
+
+// Fraction of the error learned per second of steady state samples
+#define FF_LEARN_RATE PID_FROM_FLOAT(0.3f)
+
+// Hover duty vs target altitude, and tail duty vs main duty
+static lookupTable_t hoverTable;
+static lookupTable_t tailTable;
+
+// Table values as Q16.16 duty % parameters, 0 until learned
+static int32_t hoverDuty[FF_POINTS];
+static int32_t tailDuty[FF_POINTS];
+static const char *hoverDutyNames[FF_POINTS] = {
+    "ff_hover0", "ff_hover10", "ff_hover20", "ff_hover30", "ff_hover40", "ff_hover50",
+    "ff_hover60", "ff_hover70", "ff_hover80", "ff_hover90", "ff_hover100"
+};
+static const char *tailDutyNames[FF_POINTS] = {
+    "ff_tail0", "ff_tail10", "ff_tail20", "ff_tail30", "ff_tail40", "ff_tail50",
+    "ff_tail60", "ff_tail70", "ff_tail80", "ff_tail90", "ff_tail100"
+};
+
+//
+// Rebuilds the tables from their parameters
+//
+static void applyFeedForward(void)
+{
+    uint8_t i;
+
+    // Synced control learns into the tables
+    lockControl();
+    for (i = 0; i < FF_POINTS; i++) {
+        hoverTable.y[i] = PID_FROM_Q16(hoverDuty[i]);
+        tailTable.y[i] = PID_FROM_Q16(tailDuty[i]);
+    }
+    unlockControl();
+}
+
+//
+// Initialises the feed-forward tables, unlearned tables give no feed-forward
+//
+void initFeedForward(void)
+{
+    uint8_t i;
+
+    hoverTable.size = FF_POINTS;
+    tailTable.size = FF_POINTS;
+    for (i = 0; i < FF_POINTS; i++) {
+        hoverTable.x[i] = PID_FROM_INT(i * FF_STEP);
+        tailTable.x[i] = PID_FROM_INT(i * FF_STEP);
+    }
+    applyFeedForward();
+
+    for (i = 0; i < FF_POINTS; i++) {
+        registerParam((paramId_t)(PARAM_FF_HOVER_0 + i), hoverDutyNames[i], PARAM_FIXED,
+                      &hoverDuty[i], 0, Q16_FROM_FLOAT(100.0f), applyFeedForward);
+        registerParam((paramId_t)(PARAM_FF_TAIL_0 + i), tailDutyNames[i], PARAM_FIXED,
+                      &tailDuty[i], 0, Q16_FROM_FLOAT(100.0f), applyFeedForward);
+    }
+}
+
+//
+// Gets the main rotor duty needed to hover at the target altitude
+//
+pidNum_t getHoverFeedForward(pidNum_t targetAltitude)
+{
+    return interpolateTable(&hoverTable, targetAltitude);
+}
+
+//
+// Gets the tail rotor duty that balances the main rotor duty
+//
+pidNum_t getTailFeedForward(pidNum_t mainDuty)
+{
+    return interpolateTable(&tailTable, mainDuty);
+}
+
+//
+// Learns a steady state sample of the main and tail duty, taken dt
+// seconds after the last
+//
+void learnFeedForward(pidNum_t targetAltitude, pidNum_t mainDuty, pidNum_t tailSample, pidNum_t dt)
+{
+    pidNum_t rate = PID_MUL(FF_LEARN_RATE, dt);
+    uint8_t i;
+
+    if (rate > PID_ONE) {
+        rate = PID_ONE;
+    }
+    learnTable(&hoverTable, targetAltitude, mainDuty, rate);
+    learnTable(&tailTable, mainDuty, tailSample, rate);
+
+    // Keeps the parameters in step, so save stores what was learned
+    for (i = 0; i < FF_POINTS; i++) {
+        hoverDuty[i] = PID_TO_Q16(hoverTable.y[i]);
+        tailDuty[i] = PID_TO_Q16(tailTable.y[i]);
+    }
+}
@@ -0,0 +1,41 @@
+//*****************************************************************************
+//
+// feedforward.h - Feed-forward tables for the main and tail rotors.
+// Hover duty is looked up from the target altitude and the tail duty
+// from the main rotor duty, so the PID integrators only trim residuals.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#ifndef FEEDFORWARD_H_
+#define FEEDFORWARD_H_
+
+#include <stdint.h>
+#include "pid.h"
+
+//
+// Initialises the feed-forward tables and their parameters, unlearned
+// tables give no feed-forward
+//
+void initFeedForward(void);
+
+//
+// Gets the main rotor duty needed to hover at the target altitude, in duty %
+//
+pidNum_t getHoverFeedForward(pidNum_t targetAltitude);
+
+//
+// Gets the tail rotor duty that balances the main rotor duty, in duty %
+//
+pidNum_t getTailFeedForward(pidNum_t mainDuty);
+
+//
+// Learns a steady state sample of the main and tail duty while hovering
+// at the target altitude, taken dt seconds after the last.  The tables
+// move at a set fraction of their error per second, whatever the rate.
+//
+void learnFeedForward(pidNum_t targetAltitude, pidNum_t mainDuty, pidNum_t tailSample, pidNum_t dt);
+
+#endif /*FEEDFORWARD_H_*/
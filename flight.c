@@ -0,0 +1,456 @@
+//*****************************************************************************
+//
+// flight.c - Flight state machine.  The heli's states and the transitions
+// between them are tables: each transition is taken on an event, once its
+// guards hold, and each state has entry, exit and periodic actions.
+// Guards are worked out once per pass, and the time from an event to its
+// transition is kept for each transition.
+//
+// Each pass works out the guards the current state uses, then takes the
+// first guard-only transition that holds, then handles the waiting events
+// in flightEvent_t order.  An event with no transition out of the state
+// it is handled in is dropped.
+//
+// Serial commands:
+//   flight         - prints the state and the transition timings
+//   flight reset   - clears the timings
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "driverlib/interrupt.h"
+#include "utils/ustdlib.h"
+
+#include "altitude.h"
+#include "yaw.h"
+#include "pwm.h"
+#include "control.h"
+#include "autotune.h"
+#include "recorder.h"
+#include "timer.h"
+#include "serial.h"
+#include "flight.h"
+
+#define MAX_STR_LEN 80
+
+// Guards, worked out once per pass
+#define GUARD_ALT_NEAR      0x01    // Within 2% of the target altitude
+#define GUARD_YAW_SETTLED   0x02    // Yaw has settled on its target
+#define GUARD_YAW_LANDABLE  0x04    // Yaw close enough to its target to land
+#define GUARD_TARGET_GROUND 0x08    // Target altitude is the ground
+#define GUARD_ON_GROUND     0x10    // Landing ramp done and on the ground
+#define GUARD_TUNE_DONE     0x20    // Autotune finished or gave up
+
+// Yaw error to land within, in tenths of a degree
+#define LANDING_YAW_ERROR   20
+
+//
+// A state and its actions, any of which can be NULL
+//
+typedef struct {
+    const char *name;
+    uint8_t guards;                     // Guards the state uses
+    void (*entry)(void);
+    void (*exit)(void);
+    void (*periodic)(uint8_t guards);
+} flightState_t;
+
+//
+// A transition, taken on its event (or every pass for FLIGHT_NO_EVENT)
+// once all of its guards hold
+//
+typedef struct {
+    heliState_t from;
+    flightEvent_t event;
+    uint8_t guards;
+    heliState_t to;
+    void (*action)(void);
+} flightTransition_t;
+
+//
+// Timings of a transition, in us.  For events it is the time from the
+// event to the transition, otherwise the time spent in the state.
+//
+typedef struct {
+    uint32_t count;
+    uint32_t lastUs;
+    uint32_t maxUs;
+} transitionStats_t;
+
+// Events waiting for the next pass, a power of two
+#define FLIGHT_QUEUE_SIZE 8
+
+//
+// An event waiting for the next pass, and when it was posted
+//
+typedef struct {
+    flightEvent_t event;
+    uint32_t time;
+} flightQueued_t;
+
+static void startTakeOff(void);
+static void findYaw(uint8_t guards);
+static void holdYawReference(void);
+static void holdCurrentYaw(void);
+static void holdYawReferenceTick(uint8_t guards);
+static void landSmoothly(uint8_t guards);
+static void runAutotune(uint8_t guards);
+static void keepLanded(void);
+static void keepLandedTick(uint8_t guards);
+
+static const flightState_t states[NUM_HELI_STATES] = {
+    // name         guards used                                 entry               exit            periodic
+    {"LANDED",      0,                                          keepLanded,         NULL,           keepLandedTick},
+    {"FIND_YAW",    GUARD_ALT_NEAR,                             startTakeOff,       NULL,           findYaw},
+    {"FLYING",      0,                                          NULL,               NULL,           NULL},
+    {"RESET_YAW",   GUARD_YAW_SETTLED,                          holdYawReference,   NULL,           holdYawReferenceTick},
+    {"LANDING",     GUARD_YAW_LANDABLE | GUARD_TARGET_GROUND
+                        | GUARD_ON_GROUND,                      NULL,               NULL,           landSmoothly},
+    {"AUTOTUNE",    GUARD_TUNE_DONE,                            startAutotune,      stopAutotune,   runAutotune},
+};
+
+static const flightTransition_t transitions[] = {
+    // from         event                   guards              to          action
+    {LANDED,        FLIGHT_SWITCH_UP,       0,                  FIND_YAW,   NULL},
+    {FIND_YAW,      FLIGHT_YAW_REF,         0,                  FLYING,     setYawReference},
+    {FIND_YAW,      FLIGHT_SWITCH_DOWN,     0,                  LANDING,    holdCurrentYaw},
+    {FLYING,        FLIGHT_SWITCH_DOWN,     0,                  RESET_YAW,  NULL},
+    {FLYING,        FLIGHT_AUTOTUNE,        0,                  AUTOTUNE,   NULL},
+    {AUTOTUNE,      FLIGHT_NO_EVENT,        GUARD_TUNE_DONE,    FLYING,     NULL},
+    {AUTOTUNE,      FLIGHT_SWITCH_DOWN,     0,                  RESET_YAW,  NULL},
+    {RESET_YAW,     FLIGHT_NO_EVENT,        GUARD_YAW_SETTLED,  LANDING,    NULL},
+    {LANDING,       FLIGHT_NO_EVENT,        GUARD_ON_GROUND,    LANDED,     NULL},
+};
+#define NUM_TRANSITIONS (sizeof(transitions) / sizeof(transitions[0]))
+
+static volatile heliState_t heliState = LANDED;
+static uint32_t stateEntered;
+
+// Waiting events in the order they were posted.  Posted from interrupts
+// and tasks, so both ends are only touched with interrupts masked.
+static flightQueued_t queue[FLIGHT_QUEUE_SIZE];
+static uint8_t queueHead = 0;
+static uint8_t queueTail = 0;
+static uint32_t dropped = 0;
+
+static transitionStats_t stats[NUM_TRANSITIONS];
+static uint32_t maxPassUs;
+
+static void flightCommand(char *args);
+
+//
+// Puts the heli into its take off procedure
+//
+static void startTakeOff(void)
+{
+    startMainRotor();
+    startTailRotor();
+    setTargetAltitude(10);
+}
+
+//
+// Spins the tail slowly once at the take off altitude, until the yaw
+// reference is found
+//
+static void findYaw(uint8_t guards)
+{
+    if (guards & GUARD_ALT_NEAR) {
+        setTailPower(10);
+    }
+}
+
+//
+// Holds the reference yaw for landing
+//
+static void holdYawReference(void)
+{
+    setTargetYaw(0);
+}
+
+static void holdYawReferenceTick(uint8_t guards)
+{
+    (void)guards;
+    holdYawReference();
+}
+
+//
+// Holds the yaw where it is, for landing before the reference is found
+//
+static void holdCurrentYaw(void)
+{
+    setTargetYaw(getCurrentYaw());
+}
+
+//
+// Ramps the altitude reference down to the ground once the yaw has settled
+//
+static void landSmoothly(uint8_t guards)
+{
+    if ((guards & GUARD_YAW_LANDABLE) && !(guards & GUARD_TARGET_GROUND)) {
+        setTargetAltitude(0);
+    }
+}
+
+//
+// Runs the relay experiments
+//
+static void runAutotune(uint8_t guards)
+{
+    (void)guards;
+    updateAutotune();
+}
+
+//
+// Landed, makes sure everything is off
+//
+static void keepLanded(void)
+{
+    resetDI();
+    stopTailRotor();
+    stopMainRotor();
+    setTargetAltitude(0);
+}
+
+static void keepLandedTick(uint8_t guards)
+{
+    (void)guards;
+    keepLanded();
+}
+
+//
+// Works out the guards in the mask
+//
+static uint8_t computeGuards(uint8_t needed)
+{
+    uint8_t guards = 0;
+
+    if (needed & (GUARD_ALT_NEAR | GUARD_ON_GROUND)) {
+        int32_t altitudeError = abs(getAltitudeError());
+
+        if (altitudeError < 2) {
+            guards |= GUARD_ALT_NEAR;
+        }
+        if (altitudeError < 1 && getTargetAltitude() == 0 && isAltitudeTrajectoryDone()) {
+            guards |= GUARD_ON_GROUND;
+        }
+    }
+    if (needed & (GUARD_YAW_SETTLED | GUARD_YAW_LANDABLE)) {
+        uint32_t yawError = getAverageYawError();
+
+        if (yawError < SETTLED_YAW_ERROR) {
+            guards |= GUARD_YAW_SETTLED;
+        }
+        if (yawError <= LANDING_YAW_ERROR) {
+            guards |= GUARD_YAW_LANDABLE;
+        }
+    }
+    if ((needed & GUARD_TARGET_GROUND) && getTargetAltitude() == 0) {
+        guards |= GUARD_TARGET_GROUND;
+    }
+    if ((needed & GUARD_TUNE_DONE) && isAutotuneDone()) {
+        guards |= GUARD_TUNE_DONE;
+    }
+    return guards;
+}
+
+//
+// Takes a transition, running the exit, transition and entry actions.
+// since is when its event was posted, or the state entered.
+//
+static void takeTransition(uint8_t index, uint32_t since, uint32_t now)
+{
+    const flightTransition_t *transition = &transitions[index];
+    uint32_t us = ticksToMicros(now - since);
+
+    if (states[transition->from].exit != NULL) {
+        states[transition->from].exit();
+    }
+    if (transition->action != NULL) {
+        transition->action();
+    }
+
+    heliState = transition->to;
+    stateEntered = now;
+    triggerRecorder(REC_TRIGGER_STATE);
+
+    if (states[transition->to].entry != NULL) {
+        states[transition->to].entry();
+    }
+
+    stats[index].count++;
+    stats[index].lastUs = us;
+    if (us > stats[index].maxUs) {
+        stats[index].maxUs = us;
+    }
+}
+
+//
+// Finds the transition out of the current state on an event whose guards
+// hold, returns NUM_TRANSITIONS if there isn't one
+//
+static uint8_t findTransition(flightEvent_t event, uint8_t guards)
+{
+    uint8_t i;
+
+    for (i = 0; i < NUM_TRANSITIONS; i++) {
+        if (transitions[i].from == heliState && transitions[i].event == event
+                && (transitions[i].guards & guards) == transitions[i].guards) {
+            return i;
+        }
+    }
+    return NUM_TRANSITIONS;
+}
+
+//
+// Initialises the state machine, landed
+//
+void initFlight(void)
+{
+    heliState = LANDED;
+    stateEntered = getTimestamp();
+    keepLanded();
+
+    registerCommand("flight", flightCommand);
+}
+
+//
+// Queues an event for the next pass.  Safe under interrupt.
+//
+void postFlightEvent(flightEvent_t event)
+{
+    uint32_t now = getTimestamp();
+    bool masked = IntMasterDisable();
+    uint8_t next = (queueHead + 1) & (FLIGHT_QUEUE_SIZE - 1);
+
+    if (next == queueTail) {
+        dropped++;
+    } else {
+        queue[queueHead].event = event;
+        queue[queueHead].time = now;
+        queueHead = next;
+    }
+
+    if (!masked) {
+        IntMasterEnable();
+    }
+}
+
+//
+// Takes the oldest waiting event, returns false if there are none
+//
+static bool getFlightEvent(flightQueued_t *queued)
+{
+    bool found = false;
+    bool masked = IntMasterDisable();
+
+    if (queueTail != queueHead) {
+        *queued = queue[queueTail];
+        queueTail = (queueTail + 1) & (FLIGHT_QUEUE_SIZE - 1);
+        found = true;
+    }
+
+    if (!masked) {
+        IntMasterEnable();
+    }
+    return found;
+}
+
+//
+// Works out the guards, takes any transitions and runs the periodic
+// action of the state
+//
+void updateFlight(void)
+{
+    uint32_t start = getTimestamp();
+    heliState_t guardState = heliState;
+    uint8_t guards = computeGuards(states[guardState].guards);
+    flightQueued_t queued;
+    uint8_t index;
+
+    // Guards are only good for the state they were worked out in, so at
+    // most one guard-only transition is taken per pass
+    index = findTransition(FLIGHT_NO_EVENT, guards);
+    if (index != NUM_TRANSITIONS) {
+        takeTransition(index, stateEntered, start);
+        guardState = heliState;
+    }
+
+    // Events need no guards, so they can chain through states.  Each is
+    // handled in the state the ones before it left, so an UP then DOWN
+    // takes off then lands rather than the other way round.
+    while (getFlightEvent(&queued)) {
+        index = findTransition(queued.event, 0);
+        if (index != NUM_TRANSITIONS) {
+            takeTransition(index, queued.time, getTimestamp());
+        }
+    }
+
+    if (states[heliState].periodic != NULL) {
+        // A state entered on an event this pass hasn't had its guards
+        // worked out yet
+        if (heliState != guardState) {
+            guards = computeGuards(states[heliState].guards);
+        }
+        states[heliState].periodic(guards);
+    }
+
+    uint32_t us = ticksToMicros(getTimestamp() - start);
+    if (us > maxPassUs) {
+        maxPassUs = us;
+    }
+}
+
+//
+// Get the state of the helicopter
+//
+heliState_t getHeliState(void)
+{
+    return heliState;
+}
+
+//
+// Get the name of a helicopter state
+//
+const char *getHeliStateName(heliState_t state)
+{
+    return states[state].name;
+}
+
+//
+// Prints the state and the transition timings
+//
+static void flightCommand(char *args)
+{
+    char string[MAX_STR_LEN + 1];
+    uint8_t i;
+
+    if (strcmp(args, "reset") == 0) {
+        memset(stats, 0, sizeof(stats));
+        maxPassUs = 0;
+        dropped = 0;
+        UARTSend("flight timings cleared\r\n");
+        return;
+    } else if (*args != '\0') {
+        UARTSend("usage: flight [reset]\r\n");
+        return;
+    }
+
+    usnprintf(string, sizeof(string), "flight %s for %dms, pass max %dus, dropped %d\r\n",
+              states[heliState].name, ticksToMicros(getTimestamp() - stateEntered) / 1000, maxPassUs,
+              dropped);
+    UARTSend(string);
+    for (i = 0; i < NUM_TRANSITIONS; i++) {
+        usnprintf(string, sizeof(string), "%s->%s n=%d last=%dus max=%dus\r\n",
+                  states[transitions[i].from].name, states[transitions[i].to].name,
+                  stats[i].count, stats[i].lastUs, stats[i].maxUs);
+        UARTSend(string);
+    }
+}
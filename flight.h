@@ -0,0 +1,70 @@
+//*****************************************************************************
+//
+// flight.h - Flight state machine.  The heli's states and the transitions
+// between them are tables: each transition is taken on an event, once its
+// guards hold, and each state has entry, exit and periodic actions.
+// Guards are worked out once per pass, and the time from an event to its
+// transition is kept for each transition.
+//
+// Serial commands:
+//   flight         - prints the state and the transition timings
+//   flight reset   - clears the timings
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#ifndef FLIGHT_H_
+#define FLIGHT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//
+// Type to track what the helicopter is currently doing
+//
+enum heliStates {LANDED = 0, FIND_YAW, FLYING, RESET_YAW, LANDING, AUTOTUNE, NUM_HELI_STATES};
+typedef enum heliStates heliState_t;
+
+//
+// Events that can move the heli between states.  Waiting events are
+// handled in the order they were posted.
+//
+enum flightEvents {
+    FLIGHT_SWITCH_DOWN = 0,     // Land
+    FLIGHT_SWITCH_UP,           // Take off
+    FLIGHT_AUTOTUNE,            // Start an autotune
+    FLIGHT_YAW_REF,             // Yaw reference found
+    NUM_FLIGHT_EVENTS,
+    FLIGHT_NO_EVENT = NUM_FLIGHT_EVENTS
+};
+typedef enum flightEvents flightEvent_t;
+
+//
+// Initialises the state machine, landed
+//
+void initFlight(void);
+
+//
+// Queues an event for the next pass.  Safe under interrupt.
+//
+void postFlightEvent(flightEvent_t event);
+
+//
+// Works out the guards, takes any transitions and runs the periodic
+// action of the state
+//
+void updateFlight(void);
+
+//
+// Get the state of the helicopter
+//
+heliState_t getHeliState(void);
+
+//
+// Get the name of a helicopter state
+//
+const char *getHeliStateName(heliState_t state);
+
+#endif /*FLIGHT_H_*/
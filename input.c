@@ -0,0 +1,305 @@
+//*****************************************************************************
+//
+// input.c - Interrupt driven buttons and switch.  An edge on a pin starts
+// a debounce timer, which turns settled changes into timestamped events
+// on a queue, along with long press and auto-repeat events for buttons
+// held down.  The timer only runs while an input is bouncing or held, so
+// idle inputs cost nothing, and events wait on the queue however long
+// the kernel takes to get to them.
+//
+// A pin's edge interrupt is turned off from its first edge until it has
+// read the same for INPUT_DEBOUNCE_TICKS timer ticks, so bounces don't
+// interrupt.  Only the timer interrupt adds events, and only the kernel
+// takes them, so the queue needs no locking.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "inc/hw_ints.h"
+#include "driverlib/gpio.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+#include "driverlib/interrupt.h"
+
+#include "buttons4.h"
+#include "switch.h"
+#include "timer.h"
+#include "input.h"
+
+// Debounce timer
+#define INPUT_TIMER_PERIPH      SYSCTL_PERIPH_TIMER1
+#define INPUT_TIMER_BASE        TIMER1_BASE
+#define INPUT_TIMER_INT         INT_TIMER1A
+#define INPUT_TICK_MS           5
+
+// Interrupt priority of the pins and timer, below everything else
+#define INPUT_INT_PRIORITY      0xC0
+
+// Timings, in ms
+#define INPUT_DEBOUNCE_MS       15
+#define INPUT_LONG_MS           800
+#define INPUT_REPEAT_DELAY_MS   400
+#define INPUT_REPEAT_MS         100
+
+#define INPUT_DEBOUNCE_TICKS    (INPUT_DEBOUNCE_MS / INPUT_TICK_MS)
+#define INPUT_LONG_TICKS        (INPUT_LONG_MS / INPUT_TICK_MS)
+#define INPUT_REPEAT_DELAY_TICKS (INPUT_REPEAT_DELAY_MS / INPUT_TICK_MS)
+#define INPUT_REPEAT_TICKS      (INPUT_REPEAT_MS / INPUT_TICK_MS)
+
+// Event queue size, a power of two
+#define INPUT_QUEUE_SIZE        16
+
+//
+// Pin of an input
+//
+typedef struct {
+    uint32_t port;
+    uint8_t pin;
+    bool normal;            // Level when released (switch down)
+} inputPin_t;
+
+static const inputPin_t inputPins[NUM_INPUTS] = {
+    {UP_BUT_PORT_BASE,    UP_BUT_PIN,    UP_BUT_NORMAL},
+    {DOWN_BUT_PORT_BASE,  DOWN_BUT_PIN,  DOWN_BUT_NORMAL},
+    {LEFT_BUT_PORT_BASE,  LEFT_BUT_PIN,  LEFT_BUT_NORMAL},
+    {RIGHT_BUT_PORT_BASE, RIGHT_BUT_PIN, RIGHT_BUT_NORMAL},
+    {SW1_PORT_BASE,       SW1_PIN,       SW1_NORMAL},
+};
+
+// Ports with input pins, each gets the pin interrupt handler
+static const uint32_t inputPorts[] = {
+    GPIO_PORTA_BASE, GPIO_PORTD_BASE, GPIO_PORTE_BASE, GPIO_PORTF_BASE
+};
+#define NUM_INPUT_PORTS (sizeof(inputPorts) / sizeof(inputPorts[0]))
+
+// Debounced state of each input, and its debounce and hold progress
+static volatile bool inputDown[NUM_INPUTS];
+static bool debouncing[NUM_INPUTS];
+static bool lastLevel[NUM_INPUTS];
+static uint8_t stableTicks[NUM_INPUTS];
+static uint16_t heldTicks[NUM_INPUTS];
+static uint32_t edgeTime[NUM_INPUTS];
+static volatile bool timerRunning = false;
+
+// Event queue, added to by the timer interrupt and taken from by the kernel
+static inputEvent_t queue[INPUT_QUEUE_SIZE];
+static volatile uint8_t queueHead = 0;     // Next free slot
+static volatile uint8_t queueTail = 0;     // Oldest event
+static volatile uint32_t dropped = 0;
+
+//
+// Reads an input, true when pressed (switch up)
+//
+static bool readInput(uint8_t input)
+{
+    bool high = GPIOPinRead(inputPins[input].port, inputPins[input].pin) != 0;
+    return high != inputPins[input].normal;
+}
+
+//
+// Adds an event to the queue, or counts it if the queue is full
+//
+static void pushEvent(uint8_t input, inputEventType_t type, uint32_t time)
+{
+    uint8_t next = (queueHead + 1) & (INPUT_QUEUE_SIZE - 1);
+
+    if (next == queueTail) {
+        dropped++;
+        return;
+    }
+    queue[queueHead].time = time;
+    queue[queueHead].input = input;
+    queue[queueHead].type = type;
+    queueHead = next;
+}
+
+//
+// Starts the debounce timer if it isn't running
+//
+static void startInputTimer(void)
+{
+    if (!timerRunning) {
+        timerRunning = true;
+        TimerLoadSet(INPUT_TIMER_BASE, TIMER_A, getTimerFrequency() / 1000 * INPUT_TICK_MS);
+        TimerEnable(INPUT_TIMER_BASE, TIMER_A);
+    }
+}
+
+//
+// Initialises the button and switch pins, their interrupts and the
+// debounce timer
+//
+void initInput(void)
+{
+    uint8_t i;
+
+    initButtons();
+    initSwitch();
+
+    SysCtlPeripheralEnable(INPUT_TIMER_PERIPH);
+    while (!SysCtlPeripheralReady(INPUT_TIMER_PERIPH)) {}
+    TimerConfigure(INPUT_TIMER_BASE, TIMER_CFG_PERIODIC);
+    TimerIntRegister(INPUT_TIMER_BASE, TIMER_A, inputTimerHandler);
+    TimerIntEnable(INPUT_TIMER_BASE, TIMER_TIMA_TIMEOUT);
+    IntPrioritySet(INPUT_TIMER_INT, INPUT_INT_PRIORITY);
+
+    // Starts from the current levels, so a switch left up doesn't take off
+    for (i = 0; i < NUM_INPUTS; i++) {
+        inputDown[i] = readInput(i);
+        lastLevel[i] = inputDown[i];
+        debouncing[i] = false;
+        GPIOIntTypeSet(inputPins[i].port, inputPins[i].pin, GPIO_BOTH_EDGES);
+        GPIOIntClear(inputPins[i].port, inputPins[i].pin);
+        GPIOIntEnable(inputPins[i].port, inputPins[i].pin);
+    }
+
+    for (i = 0; i < NUM_INPUT_PORTS; i++) {
+        GPIOIntRegister(inputPorts[i], inputPinHandler);
+    }
+    IntPrioritySet(INT_GPIOA, INPUT_INT_PRIORITY);
+    IntPrioritySet(INT_GPIOD, INPUT_INT_PRIORITY);
+    IntPrioritySet(INT_GPIOE, INPUT_INT_PRIORITY);
+    IntPrioritySet(INT_GPIOF, INPUT_INT_PRIORITY);
+}
+
+//
+// The interrupt handler for edges on the input pins.  Notes the time and
+// hands the pin to the debounce timer.
+//
+void inputPinHandler(void)
+{
+    uint32_t now = getTimestamp();
+    uint8_t i;
+
+    for (i = 0; i < NUM_INPUTS; i++) {
+        if (GPIOIntStatus(inputPins[i].port, true) & inputPins[i].pin) {
+            GPIOIntDisable(inputPins[i].port, inputPins[i].pin);
+            GPIOIntClear(inputPins[i].port, inputPins[i].pin);
+            edgeTime[i] = now;
+            stableTicks[i] = 0;
+            debouncing[i] = true;
+        }
+    }
+    startInputTimer();
+}
+
+//
+// Debounces an input, adding an event once it settles at a new state.
+// Returns true while it is still bouncing.
+//
+static bool debounceInput(uint8_t input)
+{
+    bool level = readInput(input);
+
+    if (level != lastLevel[input]) {
+        lastLevel[input] = level;
+        stableTicks[input] = 0;
+        return true;
+    }
+    if (++stableTicks[input] < INPUT_DEBOUNCE_TICKS) {
+        return true;
+    }
+
+    if (level != inputDown[input]) {
+        inputDown[input] = level;
+        heldTicks[input] = 0;
+        pushEvent(input, level ? INPUT_PRESS : INPUT_RELEASE, edgeTime[input]);
+    }
+
+    // Edges while the interrupt was off are covered by the level read, so
+    // they are cleared.  A change since the read starts another debounce.
+    GPIOIntClear(inputPins[input].port, inputPins[input].pin);
+    GPIOIntEnable(inputPins[input].port, inputPins[input].pin);
+    if (readInput(input) != level) {
+        GPIOIntDisable(inputPins[input].port, inputPins[input].pin);
+        edgeTime[input] = getTimestamp();
+        stableTicks[input] = 0;
+        return true;
+    }
+    debouncing[input] = false;
+    return false;
+}
+
+//
+// Adds the long press and repeat events of a held button
+//
+static void holdInput(uint8_t input)
+{
+    uint16_t held = ++heldTicks[input];
+
+    if (held == INPUT_LONG_TICKS) {
+        pushEvent(input, INPUT_LONG_PRESS, getTimestamp());
+    }
+    if (held >= INPUT_REPEAT_DELAY_TICKS
+            && (held - INPUT_REPEAT_DELAY_TICKS) % INPUT_REPEAT_TICKS == 0) {
+        pushEvent(input, INPUT_REPEAT, getTimestamp());
+    }
+
+    // Stops counting once there is nothing left to add
+    if (held == 0xFFFF) {
+        heldTicks[input] = INPUT_LONG_TICKS;
+    }
+}
+
+//
+// The interrupt handler for the debounce timer.  Stops the timer once no
+// input is bouncing or held.
+//
+void inputTimerHandler(void)
+{
+    bool active = false;
+    uint8_t i;
+
+    TimerIntClear(INPUT_TIMER_BASE, TIMER_TIMA_TIMEOUT);
+
+    for (i = 0; i < NUM_INPUTS; i++) {
+        if (debouncing[i] && debounceInput(i)) {
+            active = true;
+        } else if (inputDown[i] && i != INPUT_SWITCH) {
+            holdInput(i);
+            active = true;
+        }
+    }
+
+    if (!active) {
+        TimerDisable(INPUT_TIMER_BASE, TIMER_A);
+        timerRunning = false;
+    }
+}
+
+//
+// Takes the oldest event off the queue, returns false if it is empty
+//
+bool getInputEvent(inputEvent_t *event)
+{
+    uint8_t tail = queueTail;
+
+    if (tail == queueHead) {
+        return false;
+    }
+    *event = queue[tail];
+    queueTail = (tail + 1) & (INPUT_QUEUE_SIZE - 1);
+    return true;
+}
+
+//
+// Returns true while an input's debounced state is pressed (switch up)
+//
+bool isInputDown(uint8_t input)
+{
+    return inputDown[input];
+}
+
+//
+// Gets the number of events lost to a full queue
+//
+uint32_t getInputDropped(void)
+{
+    return dropped;
+}
@@ -0,0 +1,75 @@
+//*****************************************************************************
+//
+// input.h - Interrupt driven buttons and switch.  An edge on a pin starts
+// a debounce timer, which turns settled changes into timestamped events
+// on a queue, along with long press and auto-repeat events for buttons
+// held down.  The timer only runs while an input is bouncing or held, so
+// idle inputs cost nothing, and events wait on the queue however long
+// the kernel takes to get to them.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "buttons4.h"
+
+//
+// Inputs, the buttons (UP, DOWN, LEFT, RIGHT) then the switch
+//
+enum inputIds {INPUT_SWITCH = NUM_BUTS, NUM_INPUTS};
+
+//
+// Input events.  For the switch, pressed is up.
+//
+enum inputEventTypes {
+    INPUT_PRESS = 0,
+    INPUT_RELEASE,
+    INPUT_LONG_PRESS,       // Button held for INPUT_LONG_MS
+    INPUT_REPEAT            // Button still held, every INPUT_REPEAT_MS
+};
+typedef enum inputEventTypes inputEventType_t;
+
+typedef struct {
+    uint32_t time;          // Timestamp of the edge, or of the long press/repeat
+    uint8_t input;
+    inputEventType_t type;
+} inputEvent_t;
+
+//
+// Initialises the button and switch pins, their interrupts and the
+// debounce timer
+//
+void initInput(void);
+
+//
+// Takes the oldest event off the queue, returns false if it is empty
+//
+bool getInputEvent(inputEvent_t *event);
+
+//
+// Returns true while an input's debounced state is pressed (switch up)
+//
+bool isInputDown(uint8_t input);
+
+//
+// Gets the number of events lost to a full queue
+//
+uint32_t getInputDropped(void);
+
+//
+// The interrupt handler for edges on the input pins
+//
+void inputPinHandler(void);
+
+//
+// The interrupt handler for the debounce timer
+//
+void inputTimerHandler(void);
+
+#endif /*INPUT_H_*/
@@ -5,7 +5,7 @@
 // the task is added/registered
 //
 // Author:  bma206, tki36
-// Last modified:   14.5.2024
+// Last modified:   19.10.2026
 //
 //*****************************************************************************
 
@@ -17,13 +17,15 @@
 
 
 // Max number of tasks the kernel can have
-#define MAX_TASKS 7
+#define MAX_TASKS 8
 
 
 // Number of tasks in the kernel
 uint8_t num_tasks = 0;
 // Kernel task storage
 kernel_task tasks[MAX_TASKS];
+// Number of passes through the tasks
+static uint32_t passes = 0;
 
 //
 // Registers a new task for the kernel
@@ -56,4 +58,13 @@ void runTasks(void)
             tasks[i].currect_tick = 0;
         }
     }
+    passes++;
+}
+
+//
+// Gets the number of times the kernel has run its tasks
+//
+uint32_t getKernelPasses(void)
+{
+    return passes;
 }
@@ -5,7 +5,7 @@
 // the task is added/registered
 //
 // Author:  bma206, tki36
-// Last modified:   14.5.2024
+// Last modified:   19.10.2026
 //
 //*****************************************************************************
 
@@ -38,4 +38,9 @@ void registerTask(void (*func)(void), int16_t delay);
 //
 void runTasks(void);
 
+//
+// Gets the number of times the kernel has run its tasks
+//
+uint32_t getKernelPasses(void);
+
 #endif // Kernel_h
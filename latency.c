@@ -0,0 +1,287 @@
+//*****************************************************************************
+//
+// latency.c - Timestamp trails through a control cycle, from the altitude
+// ADC and the yaw encoder to the rotor PWM registers.  Each point of a
+// trail is marked as the data passes it, and the time between points and
+// along the whole trail is kept as statistics with a histogram for
+// percentiles.
+//
+// Serial commands:
+//   latency        - prints the stage and trail statistics
+//   latency reset  - clears them
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "driverlib/interrupt.h"
+#include "utils/ustdlib.h"
+
+#include "timer.h"
+#include "serial.h"
+#include "latency.h"
+
+#define MAX_STR_LEN 80
+
+// Largest count a histogram bin holds before they are all halved
+#define MAX_BIN_COUNT 0xFFFF
+
+//
+// Description of a point on a trail
+//
+typedef struct {
+    const char *name;
+    latencyTrail_t trail;
+    bool first;             // Starts a new pass of the trail
+} latencyPointInfo_t;
+
+static const latencyPointInfo_t pointInfo[NUM_LAT_POINTS] = {
+    {"adc",     LAT_TRAIL_ALT, true},
+    {"filter",  LAT_TRAIL_ALT, false},
+    {"control", LAT_TRAIL_ALT, false},
+    {"read",    LAT_TRAIL_ALT, false},
+    {"pid",     LAT_TRAIL_ALT, false},
+    {"pwm",     LAT_TRAIL_ALT, false},
+    {"edge",    LAT_TRAIL_YAW, true},
+    {"pid",     LAT_TRAIL_YAW, false},
+    {"pwm",     LAT_TRAIL_YAW, false},
+};
+
+// Names of the trails for the report
+static const char *trailNames[NUM_LAT_TRAILS] = {"altitude", "yaw"};
+
+// Pass number and start time of each trail
+static uint32_t trailPass[NUM_LAT_TRAILS];
+static uint32_t trailStart[NUM_LAT_TRAILS];
+
+// Pass number and time of the last pass of each point
+static uint32_t pointPass[NUM_LAT_POINTS];
+static uint32_t pointTime[NUM_LAT_POINTS];
+
+// Stage statistics, indexed by the point ending the stage, and statistics
+// of the whole trails
+static latencyStage_t stages[NUM_LAT_POINTS];
+static latencyStage_t trails[NUM_LAT_TRAILS];
+
+static void latencyCommand(char *args);
+
+//
+// Initialises the latency trails and their serial command
+//
+void initLatency(void)
+{
+    resetLatency();
+    registerCommand("latency", latencyCommand);
+}
+
+//
+// Gets the histogram bin of a time.  The bin is the top three bits of the
+// time, giving 4 bins per power of two.
+//
+static uint8_t getLatencyBin(uint32_t us)
+{
+    uint8_t msb = 2;
+
+    if (us < 4) {
+        return us;
+    }
+    while (msb < 31 && (us >> (msb + 1)) != 0) {
+        msb++;
+    }
+
+    uint32_t bin = (msb - 1) * 4 + ((us >> (msb - 2)) & 3);
+    if (bin >= LAT_HIST_BINS) {
+        bin = LAT_HIST_BINS - 1;
+    }
+    return bin;
+}
+
+//
+// Gets the largest time that falls in a histogram bin
+//
+static uint32_t getLatencyBinEdge(uint8_t bin)
+{
+    if (bin < 4) {
+        return bin;
+    }
+
+    uint8_t shift = bin / 4 - 1;
+    return ((4 + bin % 4 + 1) << shift) - 1;
+}
+
+//
+// Adds a time to a stage's statistics
+//
+static void recordLatency(latencyStage_t *stage, uint32_t us)
+{
+    uint8_t bin = getLatencyBin(us);
+    uint8_t i;
+
+    stage->lastUs = us;
+    if (us > stage->maxUs) {
+        stage->maxUs = us;
+    }
+    stage->sumUs += us;
+    stage->count++;
+
+    // Halving keeps the shape of the histogram once it has filled up
+    if (stage->bins[bin] == MAX_BIN_COUNT) {
+        for (i = 0; i < LAT_HIST_BINS; i++) {
+            stage->bins[i] /= 2;
+        }
+    }
+    stage->bins[bin]++;
+}
+
+//
+// Marks the data passing a point of a trail
+//
+void markLatency(latencyPoint_t point)
+{
+    uint32_t now = getTimestamp();
+    latencyTrail_t trail = pointInfo[point].trail;
+
+    // Can be called from interrupts at different priorities
+    bool masked = IntMasterDisable();
+
+    if (pointInfo[point].first) {
+        trailPass[trail]++;
+        trailStart[trail] = now;
+    } else if (pointPass[point] == trailPass[trail] || pointPass[point - 1] != trailPass[trail]) {
+        // Already passed this trail, or the trail didn't reach the last point
+        if (!masked) {
+            IntMasterEnable();
+        }
+        return;
+    } else {
+        recordLatency(&stages[point], ticksToMicros(now - pointTime[point - 1]));
+
+        // The last point of a trail also records the whole trail
+        if (point + 1 == NUM_LAT_POINTS || pointInfo[point + 1].first) {
+            recordLatency(&trails[trail], ticksToMicros(now - trailStart[trail]));
+        }
+    }
+    pointPass[point] = trailPass[trail];
+    pointTime[point] = now;
+
+    if (!masked) {
+        IntMasterEnable();
+    }
+}
+
+//
+// Gets the statistics of the stage ending at the given point
+//
+void getLatencyStage(latencyPoint_t point, latencyStage_t *stage)
+{
+    bool masked = IntMasterDisable();
+    *stage = stages[point];
+    if (!masked) {
+        IntMasterEnable();
+    }
+}
+
+//
+// Gets the statistics of a whole trail
+//
+void getLatencyTrail(latencyTrail_t trail, latencyStage_t *stage)
+{
+    bool masked = IntMasterDisable();
+    *stage = trails[trail];
+    if (!masked) {
+        IntMasterEnable();
+    }
+}
+
+//
+// Gets a percentile of the stage's times from its histogram
+//
+uint32_t getLatencyPercentile(const latencyStage_t *stage, uint8_t percent)
+{
+    uint32_t total = 0;
+    uint32_t seen = 0;
+    uint8_t i;
+
+    for (i = 0; i < LAT_HIST_BINS; i++) {
+        total += stage->bins[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    // Rank of the percentile, rounded up so 100% is the last time
+    uint32_t rank = (total * percent + 99) / 100;
+    if (rank == 0) {
+        rank = 1;
+    }
+    for (i = 0; i < LAT_HIST_BINS; i++) {
+        seen += stage->bins[i];
+        if (seen >= rank) {
+            break;
+        }
+    }
+    return getLatencyBinEdge(i);
+}
+
+//
+// Clears all latency statistics
+//
+void resetLatency(void)
+{
+    bool masked = IntMasterDisable();
+    memset(stages, 0, sizeof(stages));
+    memset(trails, 0, sizeof(trails));
+    if (!masked) {
+        IntMasterEnable();
+    }
+}
+
+//
+// Prints a line of statistics
+//
+static void sendLatencyStage(const char *from, const char *to, const latencyStage_t *stage)
+{
+    char string[MAX_STR_LEN + 1];
+
+    usnprintf(string, sizeof(string), "%s->%s p50=%d p90=%d p99=%d max=%d mean=%d us n=%d\r\n",
+              from, to, getLatencyPercentile(stage, 50), getLatencyPercentile(stage, 90),
+              getLatencyPercentile(stage, 99), stage->maxUs,
+              stage->count ? stage->sumUs / stage->count : 0, stage->count);
+    UARTSend(string);
+}
+
+//
+// Prints the stage and trail statistics, or clears them with "reset"
+//
+static void latencyCommand(char *args)
+{
+    latencyStage_t stage;
+    uint8_t i;
+
+    if (strcmp(args, "reset") == 0) {
+        resetLatency();
+        UARTSend("latency reset\r\n");
+        return;
+    }
+
+    for (i = 0; i < NUM_LAT_POINTS; i++) {
+        if (pointInfo[i].first) {
+            UARTSend(trailNames[pointInfo[i].trail]);
+            UARTSend("\r\n");
+            continue;
+        }
+        getLatencyStage((latencyPoint_t)i, &stage);
+        sendLatencyStage(pointInfo[i - 1].name, pointInfo[i].name, &stage);
+    }
+
+    for (i = 0; i < NUM_LAT_TRAILS; i++) {
+        getLatencyTrail((latencyTrail_t)i, &stage);
+        sendLatencyStage(trailNames[i], "total", &stage);
+    }
+}
@@ -0,0 +1,93 @@
+//*****************************************************************************
+//
+// latency.h - Timestamp trails through a control cycle, from the altitude
+// ADC and the yaw encoder to the rotor PWM registers.  Each point of a
+// trail is marked as the data passes it, and the time between points and
+// along the whole trail is kept as statistics with a histogram for
+// percentiles.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include <stdint.h>
+
+//
+// Points on the trails, in the order the data passes them.  The first
+// point of a trail starts a new pass of it.
+//
+enum latencyPoints {
+    // Altitude trail
+    LAT_ADC_SAMPLE = 0,     // ADC conversion complete
+    LAT_ADC_FILTERED,       // Sample added to the altitude filter
+    LAT_CONTROL_START,      // Control cycle started
+    LAT_ALT_READ,           // Altitude filter read
+    LAT_ALT_PID,            // Altitude PID output computed
+    LAT_MAIN_WRITTEN,       // Main rotor duty written
+    // Yaw trail
+    LAT_YAW_EDGE,           // Yaw encoder edge decoded
+    LAT_YAW_PID,            // Yaw PID output computed
+    LAT_TAIL_WRITTEN,       // Tail rotor duty written
+    NUM_LAT_POINTS
+};
+typedef enum latencyPoints latencyPoint_t;
+
+//
+// Trails through the control cycle
+//
+enum latencyTrails {LAT_TRAIL_ALT = 0, LAT_TRAIL_YAW, NUM_LAT_TRAILS};
+typedef enum latencyTrails latencyTrail_t;
+
+// Histogram bins, exact below 4 us then 4 bins per power of two up to
+// 131 ms.  Anything longer goes in the last bin.
+#define LAT_HIST_BINS 64
+
+//
+// Statistics of the time across a stage or trail, in us
+//
+typedef struct {
+    uint32_t lastUs;
+    uint32_t maxUs;
+    uint32_t sumUs;
+    uint32_t count;
+    uint16_t bins[LAT_HIST_BINS];   // Halved when a bin fills up
+} latencyStage_t;
+
+//
+// Initialises the latency trails and their serial command
+//
+void initLatency(void);
+
+//
+// Marks the data passing a point of a trail.  Only the first pass of a
+// point per trail is recorded, and only if the trail passed the point
+// before it.
+//
+void markLatency(latencyPoint_t point);
+
+//
+// Gets the statistics of the stage ending at the given point
+//
+void getLatencyStage(latencyPoint_t point, latencyStage_t *stage);
+
+//
+// Gets the statistics of a whole trail
+//
+void getLatencyTrail(latencyTrail_t trail, latencyStage_t *stage);
+
+//
+// Gets a percentile (0-100) of the stage's times, as the upper edge of
+// the histogram bin it falls in, in us
+//
+uint32_t getLatencyPercentile(const latencyStage_t *stage, uint8_t percent);
+
+//
+// Clears all latency statistics
+//
+void resetLatency(void);
+
+#endif /*LATENCY_H_*/
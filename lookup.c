@@ -0,0 +1,76 @@
+//*****************************************************************************
+//
+// lookup.c - Lookup tables with linear interpolation between breakpoints,
+// which can be adjusted online from measured samples
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lookup.h"
+
+//
+// Finds the segment containing x.  Returns the index of its lower
+// breakpoint and the weight of the upper breakpoint (0 to 1).
+//
+static uint8_t findSegment(const lookupTable_t *table, pidNum_t x, pidNum_t *weight)
+{
+    uint8_t i;
+
+    // Hold the end values outside the table
+    if (table->size < 2 || x <= table->x[0]) {
+        *weight = 0;
+        return 0;
+    }
+    if (x >= table->x[table->size - 1]) {
+        *weight = PID_ONE;
+        return table->size - 2;
+    }
+
+    for (i = 0; i < table->size - 2; i++) {
+        if (x < table->x[i + 1]) {
+            break;
+        }
+    }
+    *weight = PID_DIV(x - table->x[i], table->x[i + 1] - table->x[i]);
+    return i;
+}
+
+//
+// Gets the table value at x, interpolating between breakpoints
+//
+pidNum_t interpolateTable(const lookupTable_t *table, pidNum_t x)
+{
+    pidNum_t weight;
+
+    if (table->size == 0) {
+        return 0;
+    } else if (table->size == 1) {
+        return table->y[0];
+    }
+
+    uint8_t i = findSegment(table, x, &weight);
+    return table->y[i] + PID_MUL(table->y[i + 1] - table->y[i], weight);
+}
+
+//
+// Moves the table towards the sample value y at x
+//
+void learnTable(lookupTable_t *table, pidNum_t x, pidNum_t y, pidNum_t rate)
+{
+    pidNum_t weight;
+
+    if (table->size < 2) {
+        return;
+    }
+
+    uint8_t i = findSegment(table, x, &weight);
+    pidNum_t step = PID_MUL(y - interpolateTable(table, x), rate);
+
+    table->y[i] += PID_MUL(step, PID_ONE - weight);
+    table->y[i + 1] += PID_MUL(step, weight);
+}
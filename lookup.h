@@ -0,0 +1,42 @@
+//*****************************************************************************
+//
+// lookup.h - Lookup tables with linear interpolation between breakpoints,
+// which can be adjusted online from measured samples
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#ifndef LOOKUP_H_
+#define LOOKUP_H_
+
+#include <stdint.h>
+#include "pid.h"
+
+// Max number of breakpoints in a table
+#define LOOKUP_MAX_POINTS 11
+
+//
+// Table of breakpoints (x ascending) and their values
+//
+typedef struct {
+    uint8_t size;
+    pidNum_t x[LOOKUP_MAX_POINTS];
+    pidNum_t y[LOOKUP_MAX_POINTS];
+} lookupTable_t;
+
+//
+// Gets the table value at x, interpolating between breakpoints and
+// holding the end values outside the table
+//
+pidNum_t interpolateTable(const lookupTable_t *table, pidNum_t x);
+
+//
+// Moves the table towards the sample value y at x.  The error is shared
+// between the two surrounding breakpoints by their interpolation weights
+// and scaled by rate (0 to 1).
+//
+void learnTable(lookupTable_t *table, pidNum_t x, pidNum_t y, pidNum_t rate);
+
+#endif /*LOOKUP_H_*/
@@ -0,0 +1,260 @@
+//*****************************************************************************
+//
+// lqr.c - Coupled state-space controller for the main and tail rotors.
+// Full state feedback with integral action on the altitude and yaw, using
+// a gain matrix computed offline (discrete LQR) and built in.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "lqr.h"
+
+// Default limit, kept well inside Q16.16 range so sums can't overflow
+#define LQR_NO_LIMIT PID_FROM_INT(10000)
+
+#define LQR_TWO_PI PID_FROM_FLOAT(6.28319f)
+
+// Offsets of the states within an axis
+#define LQR_ERROR       0
+#define LQR_RATE_ERROR  1
+#define LQR_INTEGRAL    2
+
+//
+// Gain matrix, output = K * state, in Q16.16.  Rows are the main and tail
+// duty (%), columns the altitude error (%), rate error (%/s), integral
+// (%.s), then the same for yaw in degrees.
+//
+// Computed offline by iterating the discrete Riccati equation at 20 Hz for
+// a linear model of the rig around hover:
+//   altitude rate' = -2.0 * altitude rate + 4.0 * main duty
+//   yaw rate'      = -1.5 * yaw rate + 30.0 * tail duty - 20.0 * main duty
+// with Q = diag(4, 0.2, 2, 0.2, 0.01, 0.1) and R = diag(1, 0.5).  The
+// tail row's altitude terms cancel the main rotor's reaction torque as
+// the altitude loop acts.  Recompute when the model is refitted from
+// logged step responses.
+//
+static const int32_t lqrGain[LQR_AXES][LQR_STATES] = {
+    {Q16_FROM_FLOAT(2.4756f), Q16_FROM_FLOAT(0.7799f), Q16_FROM_FLOAT(1.2247f),
+     Q16_FROM_FLOAT(-0.1389f), Q16_FROM_FLOAT(-0.0334f), Q16_FROM_FLOAT(-0.0821f)},
+    {Q16_FROM_FLOAT(1.3368f), Q16_FROM_FLOAT(0.4491f), Q16_FROM_FLOAT(0.6287f),
+     Q16_FROM_FLOAT(0.6494f), Q16_FROM_FLOAT(0.1904f), Q16_FROM_FLOAT(0.3548f)},
+};
+
+//
+// Limits a value to the given range
+//
+static pidNum_t clampLQR(pidNum_t value, pidNum_t min, pidNum_t max)
+{
+    if (value > max) {
+        return max;
+    } else if (value < min) {
+        return min;
+    }
+    return value;
+}
+
+//
+// Initialises the controller with no limits and a cleared state
+//
+void initLQR(lqrCtrl_t *lqr)
+{
+    uint8_t axis;
+
+    for (axis = 0; axis < LQR_AXES; axis++) {
+        lqr->outMin[axis] = -LQR_NO_LIMIT;
+        lqr->outMax[axis] = LQR_NO_LIMIT;
+        lqr->iLimit[axis] = 0;
+        lqr->dCutoff[axis] = 0;
+        lqr->wrap[axis] = 0;
+    }
+    resetLQR(lqr);
+}
+
+//
+// Sets the min/max output of an axis
+//
+void setLQRLimits(lqrCtrl_t *lqr, uint8_t axis, pidNum_t outMin, pidNum_t outMax)
+{
+    lqr->outMin[axis] = outMin;
+    lqr->outMax[axis] = outMax;
+}
+
+//
+// Sets the max size of an axis' integral, 0 for no limit
+//
+void setLQRIntegralLimit(lqrCtrl_t *lqr, uint8_t axis, pidNum_t iLimit)
+{
+    lqr->iLimit[axis] = iLimit;
+}
+
+//
+// Sets the cutoff of the low pass filter on an axis' rate
+//
+void setLQRRateFilter(lqrCtrl_t *lqr, uint8_t axis, pidNum_t cutoff)
+{
+    lqr->dCutoff[axis] = cutoff;
+}
+
+//
+// Sets the range of an angular measurement
+//
+void setLQRMeasurementWrap(lqrCtrl_t *lqr, uint8_t axis, pidNum_t wrap)
+{
+    lqr->wrap[axis] = wrap;
+}
+
+//
+// Clears the state of the controller
+//
+void resetLQR(lqrCtrl_t *lqr)
+{
+    uint8_t i;
+
+    for (i = 0; i < LQR_STATES; i++) {
+        lqr->state[i] = 0;
+    }
+    for (i = 0; i < LQR_AXES; i++) {
+        lqr->rate[i] = 0;
+        lqr->prevMeasurement[i] = 0;
+        lqr->output[i] = 0;
+    }
+    lqr->primed = false;
+}
+
+//
+// Clears the integral of an axis
+//
+void resetLQRIntegral(lqrCtrl_t *lqr, uint8_t axis)
+{
+    lqr->state[axis * LQR_AXIS_STATES + LQR_INTEGRAL] = 0;
+}
+
+//
+// Takes over from whatever was driving the outputs, for a bumpless start.
+// With the rates cleared, what the error terms don't give of the outputs
+// has to come from the integrals, so they are the solution of the 2x2
+// system of the gains' integral columns.
+//
+void primeLQR(lqrCtrl_t *lqr, const pidNum_t output[LQR_AXES],
+              const pidNum_t error[LQR_AXES], const pidNum_t measurement[LQR_AXES])
+{
+    pidNum_t a = PID_FROM_Q16(lqrGain[LQR_ALT][LQR_ALT * LQR_AXIS_STATES + LQR_INTEGRAL]);
+    pidNum_t b = PID_FROM_Q16(lqrGain[LQR_ALT][LQR_YAW * LQR_AXIS_STATES + LQR_INTEGRAL]);
+    pidNum_t c = PID_FROM_Q16(lqrGain[LQR_YAW][LQR_ALT * LQR_AXIS_STATES + LQR_INTEGRAL]);
+    pidNum_t d = PID_FROM_Q16(lqrGain[LQR_YAW][LQR_YAW * LQR_AXIS_STATES + LQR_INTEGRAL]);
+    pidNum_t det = PID_MUL(a, d) - PID_MUL(b, c);
+    pidNum_t rest[LQR_AXES];
+    pidNum_t integral[LQR_AXES];
+    uint8_t axis;
+    uint8_t i;
+
+    resetLQR(lqr);
+    for (axis = 0; axis < LQR_AXES; axis++) {
+        lqr->state[axis * LQR_AXIS_STATES + LQR_ERROR] = error[axis];
+        lqr->prevMeasurement[axis] = measurement[axis];
+    }
+    for (axis = 0; axis < LQR_AXES; axis++) {
+        rest[axis] = output[axis];
+        for (i = 0; i < LQR_AXES; i++) {
+            rest[axis] -= PID_MUL(PID_FROM_Q16(lqrGain[axis][i * LQR_AXIS_STATES + LQR_ERROR]),
+                                  error[i]);
+        }
+    }
+    integral[LQR_ALT] = PID_DIV(PID_MUL(rest[LQR_ALT], d) - PID_MUL(b, rest[LQR_YAW]), det);
+    integral[LQR_YAW] = PID_DIV(PID_MUL(a, rest[LQR_YAW]) - PID_MUL(c, rest[LQR_ALT]), det);
+
+    for (axis = 0; axis < LQR_AXES; axis++) {
+        if (lqr->iLimit[axis] > 0) {
+            integral[axis] = clampLQR(integral[axis], -lqr->iLimit[axis], lqr->iLimit[axis]);
+        }
+        lqr->state[axis * LQR_AXIS_STATES + LQR_INTEGRAL] = integral[axis];
+        lqr->output[axis] = clampLQR(output[axis], lqr->outMin[axis], lqr->outMax[axis]);
+    }
+    lqr->primed = true;
+}
+
+//
+// Measures the filtered rate of an axis
+//
+static void updateLQRRate(lqrCtrl_t *lqr, uint8_t axis, pidNum_t measurement, pidNum_t dt)
+{
+    pidNum_t change = measurement - lqr->prevMeasurement[axis];
+    pidNum_t wrap = lqr->wrap[axis];
+
+    if (wrap > 0) {
+        if (change >= wrap / 2) {
+            change -= wrap;
+        } else if (change < -wrap / 2) {
+            change += wrap;
+        }
+    }
+    pidNum_t rate = PID_DIV(change, dt);
+
+    // First order low pass, alpha = dt / (tau + dt) with tau = 1 / (2 pi fc)
+    if (lqr->dCutoff[axis] > 0) {
+        pidNum_t tau = PID_DIV(PID_ONE, PID_MUL(LQR_TWO_PI, lqr->dCutoff[axis]));
+        pidNum_t alpha = PID_DIV(dt, tau + dt);
+        lqr->rate[axis] += PID_MUL(alpha, rate - lqr->rate[axis]);
+    } else {
+        lqr->rate[axis] = rate;
+    }
+}
+
+//
+// Runs one step of the controller
+//
+void updateLQR(lqrCtrl_t *lqr, const pidNum_t error[LQR_AXES],
+               const pidNum_t measurement[LQR_AXES], const pidNum_t rateRef[LQR_AXES],
+               pidNum_t dt)
+{
+    pidNum_t prevIntegral[LQR_AXES];
+    pidNum_t unlimited[LQR_AXES];
+    uint8_t axis;
+    uint8_t i;
+
+    // Builds the state vector
+    for (axis = 0; axis < LQR_AXES; axis++) {
+        pidNum_t *state = &lqr->state[axis * LQR_AXIS_STATES];
+
+        // No rate until there is a previous sample, avoids a start up kick
+        if (lqr->primed && dt > 0) {
+            updateLQRRate(lqr, axis, measurement[axis], dt);
+        }
+        lqr->prevMeasurement[axis] = measurement[axis];
+
+        prevIntegral[axis] = state[LQR_INTEGRAL];
+        state[LQR_ERROR] = error[axis];
+        state[LQR_RATE_ERROR] = rateRef[axis] - lqr->rate[axis];
+        state[LQR_INTEGRAL] += PID_MUL(error[axis], dt);
+        if (lqr->iLimit[axis] > 0) {
+            state[LQR_INTEGRAL] = clampLQR(state[LQR_INTEGRAL],
+                                           -lqr->iLimit[axis], lqr->iLimit[axis]);
+        }
+    }
+
+    // output = K * state
+    for (axis = 0; axis < LQR_AXES; axis++) {
+        pidNum_t sum = 0;
+        for (i = 0; i < LQR_STATES; i++) {
+            sum += PID_MUL(PID_FROM_Q16(lqrGain[axis][i]), lqr->state[i]);
+        }
+        unlimited[axis] = sum;
+        lqr->output[axis] = clampLQR(sum, lqr->outMin[axis], lqr->outMax[axis]);
+    }
+
+    // Anti-windup, an axis only integrates when its output isn't limited
+    // in its error's direction
+    for (axis = 0; axis < LQR_AXES; axis++) {
+        if ((lqr->output[axis] < unlimited[axis] && error[axis] > 0)
+                || (lqr->output[axis] > unlimited[axis] && error[axis] < 0)) {
+            lqr->state[axis * LQR_AXIS_STATES + LQR_INTEGRAL] = prevIntegral[axis];
+        }
+    }
+
+    lqr->primed = true;
+}
@@ -0,0 +1,102 @@
+//*****************************************************************************
+//
+// lqr.h - Coupled state-space controller for the main and tail rotors.
+// Full state feedback with integral action on the altitude and yaw, using
+// a gain matrix computed offline (discrete LQR) and built in.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#ifndef LQR_H_
+#define LQR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pid.h"
+
+//
+// Controlled axes, also the order of the outputs (main, tail)
+//
+enum lqrAxes {LQR_ALT = 0, LQR_YAW, LQR_AXES};
+
+// Each axis has an error, rate error and integral state
+#define LQR_AXIS_STATES 3
+#define LQR_STATES (LQR_AXES * LQR_AXIS_STATES)
+
+//
+// LQR limits and state
+//
+typedef struct {
+    // Limits and measurement settings per axis
+    pidNum_t outMin[LQR_AXES];
+    pidNum_t outMax[LQR_AXES];
+    pidNum_t iLimit[LQR_AXES];      // Max size of the integral, 0 is no limit
+    pidNum_t dCutoff[LQR_AXES];     // Rate filter cutoff in Hz, 0 is unfiltered
+    pidNum_t wrap[LQR_AXES];        // Range of an angular measurement, 0 if it doesn't wrap
+
+    // State
+    pidNum_t state[LQR_STATES];     // Error, rate error and integral per axis
+    pidNum_t rate[LQR_AXES];        // Filtered rate of the measurements
+    pidNum_t prevMeasurement[LQR_AXES];
+    pidNum_t output[LQR_AXES];
+    bool primed;                    // Set once prev values are valid
+} lqrCtrl_t;
+
+//
+// Initialises the controller with no limits and a cleared state
+//
+void initLQR(lqrCtrl_t *lqr);
+
+//
+// Sets the min/max output of an axis
+//
+void setLQRLimits(lqrCtrl_t *lqr, uint8_t axis, pidNum_t outMin, pidNum_t outMax);
+
+//
+// Sets the max size of an axis' integral, 0 for no limit
+//
+void setLQRIntegralLimit(lqrCtrl_t *lqr, uint8_t axis, pidNum_t iLimit);
+
+//
+// Sets the cutoff of the low pass filter on an axis' rate, in Hz.  0 turns
+// the filter off.
+//
+void setLQRRateFilter(lqrCtrl_t *lqr, uint8_t axis, pidNum_t cutoff);
+
+//
+// Sets the range of an angular measurement (e.g. 360 degrees) so its rate
+// ignores it wrapping around.  0 for none.
+//
+void setLQRMeasurementWrap(lqrCtrl_t *lqr, uint8_t axis, pidNum_t wrap);
+
+//
+// Clears the state of the controller
+//
+void resetLQR(lqrCtrl_t *lqr);
+
+//
+// Clears the integral of an axis
+//
+void resetLQRIntegral(lqrCtrl_t *lqr, uint8_t axis);
+
+//
+// Takes over from whatever was driving the outputs, for a bumpless start.
+// The integrals are solved for so the outputs match the ones being
+// applied at the current errors, and the previous measurements are set
+// so the rates don't kick.
+//
+void primeLQR(lqrCtrl_t *lqr, const pidNum_t output[LQR_AXES],
+              const pidNum_t error[LQR_AXES], const pidNum_t measurement[LQR_AXES]);
+
+//
+// Runs one step from the errors (wrapped by the caller), measurements and
+// reference rates of each axis.  The limited outputs are left in
+// lqr->output.
+//
+void updateLQR(lqrCtrl_t *lqr, const pidNum_t error[LQR_AXES],
+               const pidNum_t measurement[LQR_AXES], const pidNum_t rateRef[LQR_AXES],
+               pidNum_t dt);
+
+#endif /*LQR_H_*/
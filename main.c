@@ -4,7 +4,7 @@
 // 
 //
 // Author:  bma206, tki36
-// Last modified:   21.4.2024
+// Last modified:   19.10.2026
 //
 //*****************************************************************************
 // Based on the 'convert' series from 2016
@@ -25,25 +25,32 @@
 #include "circBufT.h"
 #include "OrbitOLED/OrbitOLEDInterface.h"
 #include "display.h"
-#include "buttons4.h"
+#include "input.h"
 #include "altitude.h"
 #include "yaw.h"
 #include "pwm.h"
 #include "serial.h"
 #include "kernel.h"
-#include "switch.h"
+#include "flight.h"
 #include "control.h"
+#include "timer.h"
+#include "params.h"
+#include "latency.h"
+#include "telemetry.h"
+#include "recorder.h"
+#include "pidbench.h"
 
 
 #define SAMPLE_RATE_HZ 100
 
 // How often the kernel tasks update
-#define BUTTON_UPDATE 1
+#define INPUT_UPDATE 1
 #define UART_UPDATE 5
 #define DISPLAY_UPDATE 1
 #define CONTROL_UPDATE 1
-#define SWITCH_UPDATE 1
-#define STATE_UPDATE 1
+#define FLIGHT_UPDATE 1
+#define COMMAND_UPDATE 1
+#define RECORDER_UPDATE 1
 
 
 static uint32_t g_ulSampCnt;    // Counter for the interrupts
@@ -82,85 +89,66 @@ void initClock(void)
     SysTickEnable();
 }
 
-//
-// Checks the state of all buttons and performs relevant changes
-//
-void checkButtons(void)
-{
-    updateButtons();
-
-    uint8_t butState = checkButton (UP); // Increase altitude
-    if (butState == PUSHED && isSettled()) {
-        incrementAltitude(10);
-    }
-    butState = checkButton (DOWN); // Decrease altitude
-    if (butState == PUSHED && isSettled()) {
-        incrementAltitude(-10);
-    }
-    butState = checkButton (LEFT); // Rotate left
-    if (butState == PUSHED && getAltitudeError() <= 5) {
-        incrementYaw(15);
-    }
-    butState = checkButton (RIGHT); // Rotate Right
-    if (butState == PUSHED && getAltitudeError() <= 5) {
-        incrementYaw(-15);
-    }
-}
+// Set once DOWN has stepped the altitude or been used for the autotune
+// combo since it was pressed, so its release doesn't step it again
+static bool downUsed = false;
 
 //
-// Checks the state of switch 1
+// Acts on a button press, release or repeat while it is held.  DOWN steps
+// on release, or repeat, so pressing UP while holding it can start the
+// autotune without moving the altitude first.
 //
-void checkSwitch(void)
+void handleButton(uint8_t button, inputEventType_t type)
 {
-    swState_t swState = updateSwitch();
-    if (swState == UP && getHeliState() == LANDED) { // Puts heli into take off procedure
-        startMainRotor();
-        startTailRotor();
-        setTargetAltitude(10);
-        setHeliState(FIND_YAW);
-    } else if (swState == DOWN && getHeliState() == FLYING) { // Puts the heli into landing procedure
-        setHeliState(RESET_YAW);
+    if (button == UP) { // Increase altitude
+        if (isInputDown(DOWN)) {
+            if (type == INPUT_PRESS && !downUsed && getHeliState() == FLYING) {
+                postFlightEvent(FLIGHT_AUTOTUNE); // UP while holding DOWN autotunes the PIDs
+            }
+            downUsed = true;
+        } else if ((type == INPUT_PRESS || type == INPUT_REPEAT) && isSettled()) {
+            incrementAltitude(10);
+        }
+    } else if (button == DOWN) { // Decrease altitude
+        if (type == INPUT_PRESS) {
+            downUsed = false;
+        } else if (type == INPUT_REPEAT || (type == INPUT_RELEASE && !downUsed)) {
+            if (isSettled()) {
+                incrementAltitude(-10);
+            }
+            downUsed = true;
+        }
+    } else if (type == INPUT_PRESS || type == INPUT_REPEAT) {
+        if (button == LEFT) { // Rotate left
+            if (getAltitudeError() <= 5) {
+                incrementYaw(15);
+            }
+        } else if (button == RIGHT) { // Rotate Right
+            if (getAltitudeError() <= 5) {
+                incrementYaw(-15);
+            }
+        }
     }
 }
 
 //
-// Manages the automatic states (landing, take off, find yaw and reset yaw)
+// Handles the button and switch events queued since the last pass
 //
-void heliStateManager(void)
+void checkInputs(void)
 {
-    // Gets the heli state
-    heliState_t state = getHeliState();
-
-    // Take off - Finds the reference pin
-    if (state == FIND_YAW) {
-        if(abs(getAltitudeError()) < 2) {
-            setTailPower(10);
-        }
-    // Reset yaw - go to yaw 0 for landing
-    } else if (state == RESET_YAW) {
-        resetPosition();
-
-    } else if (state == LANDING) { // Smoothly lands the heli
-        if(canLand(30) && getTargetAltitude() > 30 && abs(getAltitudeError()) <= 4) { // Checks that the heli has settle before going down
-            incrementAltitude(-5);
-        }else if(canLand(25) && getTargetAltitude() <= 30 && getTargetAltitude() > 10 && abs(getAltitudeError()) < 2) {
-            incrementAltitude(-5);
+    inputEvent_t event;
+
+    while (getInputEvent(&event)) {
+        if (event.input == INPUT_SWITCH) {
+            // Up takes off, down lands
+            if (event.type == INPUT_PRESS) {
+                postFlightEvent(FLIGHT_SWITCH_UP);
+            } else if (event.type == INPUT_RELEASE) {
+                postFlightEvent(FLIGHT_SWITCH_DOWN);
+            }
+        } else {
+            handleButton(event.input, event.type);
         }
-        else if (canLand(20) && getTargetAltitude() <= 10 && abs(getAltitudeError()) == 0) { // smoothly lands
-            incrementAltitude(-1);
-        }
-        else if(abs(getAltitudeError()) < 1 && getTargetAltitude() == 0) { // Sets the heli to landed
-            setHeliState(LANDED);
-            stopTailRotor();
-            stopMainRotor();
-            resetDI();
-        }
-
-    } else if (state == LANDED) { // Landed, make sure everything is off
-        resetDI();
-        stopTailRotor();
-        stopMainRotor();
-        setTargetAltitude(0);
     }
 }
 
@@ -170,16 +158,24 @@ int main(void)
 
     // initialise different systems
     initClock ();
-    initButtons();
-    initSwitch();
+    initTimer();
+    initParams();
+    initLatency();
+    initInput();
     initAltitude ();
     initYaw ();
     initPWM();
     initUART();
+    initTelemetry();
+    initRecorder();
     initDisplay ();
+    initControl();
+    initFlight();
+    initPIDBench();
+
+    // Loads the saved tuning once every module has registered its parameters
+    loadParams();
 
-    // Set the heli state to landed
-    setHeliState(LANDED);
     // Enable interrupts to the processor.
     IntMasterEnable();
 
@@ -188,18 +184,20 @@ int main(void)
     setBaseAltitude(getAltitudeADC());
 
 
-    // Buttons
-    registerTask(*checkButtons, BUTTON_UPDATE);
+    // Buttons and switch
+    registerTask(*checkInputs, INPUT_UPDATE);
     // UART (serial com)
-    registerTask(*UARTSendData, UART_UPDATE);
+    registerTask(*sendTelemetry, UART_UPDATE);
     // control
     registerTask(*updateControl, CONTROL_UPDATE);
-    // switch
-    registerTask(*checkSwitch, SWITCH_UPDATE);
     // helicopter state control
-    registerTask(*heliStateManager, STATE_UPDATE);
+    registerTask(*updateFlight, FLIGHT_UPDATE);
     // Display
     registerTask(*updateDisplay, DISPLAY_UPDATE);
+    // Serial commands
+    registerTask(*processSerialCommands, COMMAND_UPDATE);
+    // Black box dumps
+    registerTask(*dumpRecorder, RECORDER_UPDATE);
 
 
     while (1) // Main loop
@@ -0,0 +1,270 @@
+//*****************************************************************************
+//
+// oled.c - Asynchronous driver for the Orbit OLED.  Drawing goes into a
+// framebuffer in RAM and marks the columns it changed.  A flush streams
+// the changed columns to the screen from the SSI interrupt, a FIFO's
+// worth at a time, so callers never wait on the SPI transfer.
+//
+// The vendor library still powers the screen up, configures SSI3 and its
+// pins, and provides the font.  Nothing else of it is used afterwards, as
+// its drawing sends the whole screen synchronously.
+//
+// Each dirty page is sent as a command phase, setting the page and start
+// column, then a data phase of the changed columns.  The data/command pin
+// can only change once the last byte has left, so the SSI is run in end
+// of transmission mode, where its TX interrupt fires once the FIFO is
+// empty and the bus idle.  tools/oledcheck.c runs the driver against a
+// model of the panel on the host.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "inc/hw_ints.h"
+#include "inc/hw_ssi.h"
+#include "driverlib/gpio.h"
+#include "driverlib/ssi.h"
+#include "driverlib/interrupt.h"
+#include "OrbitOLED/OrbitOLEDInterface.h"
+#include "OrbitOLED/lib_OrbitOled/OrbitBoosterPackDefs.h"
+
+#include "oled.h"
+
+// SSI the screen is on, set up by OLEDInitialise()
+#define OLED_SSI_BASE       SSI3_BASE
+#define OLED_SSI_INT        INT_SSI3
+#define OLED_INT_PRIORITY   0xA0    // Below the control and sensor interrupts
+#define OLED_FIFO_DEPTH     8
+
+// Data/command select of the screen, low for commands.  Taken from the
+// vendor library's pin map so it can't disagree with the pin it set up.
+#define OLED_DC_PORT        nDC_OLEDPort
+#define OLED_DC_PIN         nDC_OLED
+
+// SSD1306 page addressing commands
+#define OLED_CMD_PAGE       0xB0
+#define OLED_CMD_COL_LOW    0x00
+#define OLED_CMD_COL_HIGH   0x10
+
+// Font of the vendor library, 8 column bytes per glyph from ' '
+extern unsigned char rgbOledFont0[];
+#define OLED_FONT_FIRST     ' '
+#define OLED_FONT_LAST      0x7F
+#define OLED_GLYPH_WIDTH    8
+
+//
+// Transfer phases
+//
+enum oledPhases {OLED_IDLE = 0, OLED_COMMAND, OLED_DATA};
+
+// Framebuffer, and the changed columns of each page (end exclusive, clean
+// when start >= end)
+static uint8_t frame[OLED_PAGES][OLED_WIDTH];
+static uint8_t dirtyStart[OLED_PAGES];
+static uint8_t dirtyEnd[OLED_PAGES];
+
+// Transfer state, owned by the interrupt while a transfer runs
+static volatile uint8_t phase = OLED_IDLE;
+static uint8_t sendPage = 0;
+static uint8_t sendCol;
+static uint8_t sendEnd;
+
+//
+// Marks columns of a page as changed
+//
+static void markDirty(uint8_t page, uint8_t start, uint8_t end)
+{
+    bool masked = IntMasterDisable();
+
+    if (dirtyStart[page] >= dirtyEnd[page]) {
+        dirtyStart[page] = start;
+        dirtyEnd[page] = end;
+    } else {
+        if (start < dirtyStart[page]) {
+            dirtyStart[page] = start;
+        }
+        if (end > dirtyEnd[page]) {
+            dirtyEnd[page] = end;
+        }
+    }
+
+    if (!masked) {
+        IntMasterEnable();
+    }
+}
+
+//
+// Starts the command phase of the next dirty page, after the last one
+// sent.  Returns false if no page is dirty.  Only called with the bus idle.
+//
+static bool startNextPage(void)
+{
+    uint8_t i;
+
+    for (i = 1; i <= OLED_PAGES; i++) {
+        uint8_t page = (sendPage + i) % OLED_PAGES;
+
+        if (dirtyStart[page] < dirtyEnd[page]) {
+            // Takes the page's changes, anything drawn from now on marks
+            // it again
+            sendPage = page;
+            sendCol = dirtyStart[page];
+            sendEnd = dirtyEnd[page];
+            dirtyStart[page] = OLED_WIDTH;
+            dirtyEnd[page] = 0;
+
+            GPIOPinWrite(OLED_DC_PORT, OLED_DC_PIN, 0);
+            SSIDataPutNonBlocking(OLED_SSI_BASE, OLED_CMD_PAGE | page);
+            SSIDataPutNonBlocking(OLED_SSI_BASE, OLED_CMD_COL_LOW | (sendCol & 0x0F));
+            SSIDataPutNonBlocking(OLED_SSI_BASE, OLED_CMD_COL_HIGH | (sendCol >> 4));
+            phase = OLED_COMMAND;
+            return true;
+        }
+    }
+    return false;
+}
+
+//
+// Sends the next part of the transfer.  Only called with the bus idle.
+//
+static void sendNextChunk(void)
+{
+    if (phase == OLED_COMMAND) {
+        GPIOPinWrite(OLED_DC_PORT, OLED_DC_PIN, OLED_DC_PIN);
+        phase = OLED_DATA;
+    }
+
+    if (phase == OLED_DATA && sendCol < sendEnd) {
+        uint8_t count = 0;
+        while (sendCol < sendEnd && count < OLED_FIFO_DEPTH) {
+            SSIDataPutNonBlocking(OLED_SSI_BASE, frame[sendPage][sendCol++]);
+            count++;
+        }
+        return;
+    }
+
+    if (!startNextPage()) {
+        phase = OLED_IDLE;
+        SSIIntDisable(OLED_SSI_BASE, SSI_TXFF);
+    }
+}
+
+//
+// The SSI interrupt handler, sends the next part of the transfer.  The TX
+// interrupt follows the FIFO level, so there is nothing to clear.
+//
+void OLEDIntHandler(void)
+{
+    sendNextChunk();
+}
+
+//
+// Powers up the screen and takes over its SSI for interrupt driven
+// transfers
+//
+void initOLED(void)
+{
+    OLEDInitialise();
+
+    // TX interrupt on the end of transmission rather than the FIFO level,
+    // set with the SSI disabled
+    SSIDisable(OLED_SSI_BASE);
+    HWREG(OLED_SSI_BASE + SSI_O_CR1) |= SSI_CR1_EOT;
+    SSIEnable(OLED_SSI_BASE);
+
+    SSIIntRegister(OLED_SSI_BASE, OLEDIntHandler);
+    IntPrioritySet(OLED_SSI_INT, OLED_INT_PRIORITY);
+
+    // OLEDInitialise() leaves the screen blank, so the framebuffer matches
+    memset(frame, 0, sizeof(frame));
+    memset(dirtyStart, OLED_WIDTH, sizeof(dirtyStart));
+    memset(dirtyEnd, 0, sizeof(dirtyEnd));
+}
+
+//
+// Clears the framebuffer
+//
+void clearOLED(void)
+{
+    uint8_t page;
+
+    memset(frame, 0, sizeof(frame));
+    for (page = 0; page < OLED_PAGES; page++) {
+        markDirty(page, 0, OLED_WIDTH);
+    }
+}
+
+//
+// Draws a string into the framebuffer at a character column and row
+//
+void drawOLEDString(const char *string, uint8_t col, uint8_t row)
+{
+    uint8_t start = col * OLED_GLYPH_WIDTH;
+    uint8_t x = start;
+
+    if (row >= OLED_TEXT_ROWS) {
+        return;
+    }
+
+    while (*string != '\0' && col < OLED_TEXT_COLS) {
+        uint8_t c = *string++;
+
+        if (c < OLED_FONT_FIRST || c > OLED_FONT_LAST) {
+            c = '?';
+        }
+        memcpy(&frame[row][x], &rgbOledFont0[(c - OLED_FONT_FIRST) * OLED_GLYPH_WIDTH],
+               OLED_GLYPH_WIDTH);
+        x += OLED_GLYPH_WIDTH;
+        col++;
+    }
+
+    if (x > start) {
+        markDirty(row, start, x);
+    }
+}
+
+//
+// Sets a column of a page in the framebuffer
+//
+void setOLEDColumn(uint8_t x, uint8_t page, uint8_t pixels)
+{
+    if (x >= OLED_WIDTH || page >= OLED_PAGES || frame[page][x] == pixels) {
+        return;
+    }
+    frame[page][x] = pixels;
+    markDirty(page, x, x + 1);
+}
+
+//
+// Starts sending the changed parts of the framebuffer
+//
+void flushOLED(void)
+{
+    if (phase != OLED_IDLE) {
+        return;
+    }
+
+    // The bus is idle once a transfer has finished, so the first page can
+    // be started here and the interrupt takes it from there
+    bool masked = IntMasterDisable();
+    if (startNextPage()) {
+        SSIIntEnable(OLED_SSI_BASE, SSI_TXFF);
+    }
+    if (!masked) {
+        IntMasterEnable();
+    }
+}
+
+//
+// Returns true while a transfer is running
+//
+bool isOLEDBusy(void)
+{
+    return phase != OLED_IDLE;
+}
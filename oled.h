@@ -0,0 +1,65 @@
+//*****************************************************************************
+//
+// oled.h - Asynchronous driver for the Orbit OLED.  Drawing goes into a
+// framebuffer in RAM and marks the columns it changed.  A flush streams
+// the changed columns to the screen from the SSI interrupt, a FIFO's
+// worth at a time, so callers never wait on the SPI transfer.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#ifndef OLED_H_
+#define OLED_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Screen size in pixels, and in 8 pixel high pages
+#define OLED_WIDTH      128
+#define OLED_HEIGHT     32
+#define OLED_PAGES      (OLED_HEIGHT / 8)
+
+// Screen size in 8x8 characters
+#define OLED_TEXT_COLS  (OLED_WIDTH / 8)
+#define OLED_TEXT_ROWS  OLED_PAGES
+
+//
+// Powers up the screen and takes over its SSI for interrupt driven
+// transfers
+//
+void initOLED(void);
+
+//
+// Clears the framebuffer
+//
+void clearOLED(void);
+
+//
+// Draws a string into the framebuffer at a character column and row
+//
+void drawOLEDString(const char *string, uint8_t col, uint8_t row);
+
+//
+// Sets a column of a page in the framebuffer, bit 0 is the top pixel
+//
+void setOLEDColumn(uint8_t x, uint8_t page, uint8_t pixels);
+
+//
+// Starts sending the changed parts of the framebuffer, if a transfer
+// isn't already running.  Returns straight away.
+//
+void flushOLED(void);
+
+//
+// Returns true while a transfer is running
+//
+bool isOLEDBusy(void);
+
+//
+// The SSI interrupt handler, sends the next part of the transfer
+//
+void OLEDIntHandler(void);
+
+#endif /*OLED_H_*/
@@ -0,0 +1,357 @@
+//*****************************************************************************
+//
+// params.c - Runtime parameter store.  Tuning constants are registered by
+// their modules with a range and default, can be read and changed over
+// serial while flying, and are saved to EEPROM.
+//
+// Serial commands:
+//   list               - prints all parameters
+//   get <name>         - prints a parameter
+//   set <name> <value> - changes a parameter, fixed values take decimals
+//   save               - saves all parameters to EEPROM
+//   defaults           - puts all parameters back to their defaults
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/eeprom.h"
+#include "utils/ustdlib.h"
+
+#include "serial.h"
+#include "params.h"
+
+// EEPROM layout: magic, number of parameters saved, one word per
+// parameter, then a checksum.  Parameters are only ever added to the end,
+// so a save with a different count still holds the ones both know about.
+#define PARAMS_EEPROM_ADDR  0
+#define PARAMS_MAGIC        0x5A180000
+#define PARAMS_HEADER_WORDS 2
+#define MAX_SAVED_PARAMS    256
+
+// Max number of decimal places accepted for fixed values
+#define MAX_DECIMALS 4
+
+#define MAX_STR_LEN 40
+
+// Registered parameters
+static param_t params[NUM_PARAMS];
+static bool eepromReady = false;
+
+static void listCommand(char *args);
+static void getCommand(char *args);
+static void setCommand(char *args);
+static void saveCommand(char *args);
+static void defaultsCommand(char *args);
+
+//
+// Initialises the parameter store and its serial commands
+//
+void initParams(void)
+{
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_EEPROM0);
+    while (!SysCtlPeripheralReady(SYSCTL_PERIPH_EEPROM0)) {}
+    eepromReady = (EEPROMInit() == EEPROM_INIT_OK);
+
+    registerCommand("list", listCommand);
+    registerCommand("get", getCommand);
+    registerCommand("set", setCommand);
+    registerCommand("save", saveCommand);
+    registerCommand("defaults", defaultsCommand);
+}
+
+//
+// Registers a module variable as a parameter
+//
+void registerParam(paramId_t id, const char *name, paramType_t type, int32_t *value,
+                   int32_t min, int32_t max, void (*onChange)(void))
+{
+    if (id >= NUM_PARAMS) {
+        return;
+    }
+    param_t new_param = {name, type, value, min, max, *value, onChange};
+    params[id] = new_param;
+}
+
+//
+// Sets a parameter, returns false if the value is out of range
+//
+bool setParam(paramId_t id, int32_t value)
+{
+    if (id >= NUM_PARAMS) {
+        return false;
+    }
+
+    param_t *param = &params[id];
+    if (param->value == NULL || value < param->min || value > param->max) {
+        return false;
+    }
+
+    *param->value = value;
+    if (param->onChange != NULL) {
+        param->onChange();
+    }
+    return true;
+}
+
+//
+// Gets the value of a parameter
+//
+int32_t getParam(paramId_t id)
+{
+    if (id >= NUM_PARAMS || params[id].value == NULL) {
+        return 0;
+    }
+    return *params[id].value;
+}
+
+//
+// Adds a saved word to the checksum
+//
+static uint32_t addChecksum(uint32_t sum, uint32_t word)
+{
+    return (sum << 1 | sum >> 31) ^ word;
+}
+
+//
+// Loads the saved parameters from EEPROM.  A save with fewer parameters
+// than this build leaves the new ones at their defaults, and one with
+// more has the extra ones ignored.
+//
+void loadParams(void)
+{
+    uint32_t header[PARAMS_HEADER_WORDS];
+    uint32_t values[NUM_PARAMS];
+    uint32_t word;
+    uint32_t sum = 0;
+    uint32_t count;
+    uint32_t addr = PARAMS_EEPROM_ADDR;
+    uint32_t i;
+
+    if (!eepromReady) {
+        return;
+    }
+
+    EEPROMRead(header, addr, sizeof(header));
+    addr += sizeof(header);
+    count = header[1];
+    if (header[0] != PARAMS_MAGIC || count > MAX_SAVED_PARAMS) {
+        return; // Nothing valid saved, keep the defaults
+    }
+    sum = addChecksum(addChecksum(sum, header[0]), header[1]);
+
+    // Reads a word at a time, so a longer save needs no bigger buffer
+    for (i = 0; i < count; i++) {
+        EEPROMRead(&word, addr, sizeof(word));
+        addr += sizeof(word);
+        sum = addChecksum(sum, word);
+        if (i < NUM_PARAMS) {
+            values[i] = word;
+        }
+    }
+    EEPROMRead(&word, addr, sizeof(word));
+    if (word != sum) {
+        return;
+    }
+
+    for (i = 0; i < count && i < NUM_PARAMS; i++) {
+        setParam((paramId_t)i, (int32_t)values[i]);
+    }
+}
+
+//
+// Saves all parameters to EEPROM, returns false if it failed
+//
+bool saveParams(void)
+{
+    uint32_t words[PARAMS_HEADER_WORDS + NUM_PARAMS + 1];
+    uint32_t sum = 0;
+    uint8_t i;
+
+    if (!eepromReady) {
+        return false;
+    }
+
+    words[0] = PARAMS_MAGIC;
+    words[1] = NUM_PARAMS;
+    for (i = 0; i < NUM_PARAMS; i++) {
+        words[PARAMS_HEADER_WORDS + i] = (uint32_t)getParam((paramId_t)i);
+    }
+    for (i = 0; i < PARAMS_HEADER_WORDS + NUM_PARAMS; i++) {
+        sum = addChecksum(sum, words[i]);
+    }
+    words[PARAMS_HEADER_WORDS + NUM_PARAMS] = sum;
+
+    return EEPROMProgram(words, PARAMS_EEPROM_ADDR, sizeof(words)) == 0;
+}
+
+//
+// Finds a parameter by name, returns NUM_PARAMS if there isn't one
+//
+static paramId_t findParam(const char *name)
+{
+    uint8_t i;
+    for (i = 0; i < NUM_PARAMS; i++) {
+        if (params[i].name != NULL && strcmp(params[i].name, name) == 0) {
+            return (paramId_t)i;
+        }
+    }
+    return NUM_PARAMS;
+}
+
+//
+// Parses a value for the parameter type.  Fixed values can have up to
+// MAX_DECIMALS decimal places.  Returns false if it isn't a number or
+// doesn't fit the type.
+//
+static bool parseValue(const char *str, paramType_t type, int32_t *value)
+{
+    bool negative = false;
+    int32_t whole = 0;
+    int32_t frac = 0;
+    int32_t fracScale = 1;
+    uint8_t decimals = 0;
+
+    if (*str == '-') {
+        negative = true;
+        str++;
+    }
+    if (*str < '0' || *str > '9') {
+        return false;
+    }
+    while (*str >= '0' && *str <= '9') {
+        int32_t digit = *str - '0';
+        if (whole > (INT32_MAX - digit) / 10) {
+            return false;
+        }
+        whole = whole * 10 + digit;
+        str++;
+    }
+    if (type == PARAM_FIXED && whole > INT16_MAX) {
+        return false; // Doesn't fit Q16.16
+    }
+    if (*str == '.' && type == PARAM_FIXED) {
+        str++;
+        while (*str >= '0' && *str <= '9' && decimals < MAX_DECIMALS) {
+            frac = frac * 10 + (*str - '0');
+            fracScale *= 10;
+            decimals++;
+            str++;
+        }
+    }
+    if (*str != '\0') {
+        return false;
+    }
+
+    if (type == PARAM_FIXED) {
+        *value = (whole << 16) + (int32_t)(((int64_t)frac << 16) / fracScale);
+    } else {
+        *value = whole;
+    }
+    if (negative) {
+        *value = -*value;
+    }
+    return true;
+}
+
+//
+// Sends "name=value", fixed values with 3 decimal places
+//
+static void sendParam(paramId_t id)
+{
+    char string[MAX_STR_LEN + 1];
+    const param_t *param = &params[id];
+    int32_t value = *param->value;
+
+    if (param->type == PARAM_FIXED) {
+        // Rounds the whole value to thousandths, so a fraction rounding up
+        // carries into the whole part
+        uint32_t magnitude = value < 0 ? -(uint32_t)value : (uint32_t)value;
+        uint32_t rounded = ((uint64_t)magnitude * 1000 + 0x8000) >> 16;
+        usnprintf(string, sizeof(string), "%s=%s%d.%03d\r\n", param->name,
+                  (value < 0 && rounded != 0) ? "-" : "", rounded / 1000, rounded % 1000);
+    } else {
+        usnprintf(string, sizeof(string), "%s=%d\r\n", param->name, value);
+    }
+    UARTSend(string);
+}
+
+//
+// Prints all parameters
+//
+static void listCommand(char *args)
+{
+    uint8_t i;
+    for (i = 0; i < NUM_PARAMS; i++) {
+        if (params[i].value != NULL) {
+            sendParam((paramId_t)i);
+        }
+    }
+}
+
+//
+// Prints the named parameter
+//
+static void getCommand(char *args)
+{
+    paramId_t id = findParam(args);
+    if (id == NUM_PARAMS) {
+        UARTSend("unknown parameter\r\n");
+        return;
+    }
+    sendParam(id);
+}
+
+//
+// Sets the named parameter, args are "<name> <value>"
+//
+static void setCommand(char *args)
+{
+    int32_t value;
+    char *valueStr = strchr(args, ' ');
+
+    if (valueStr == NULL) {
+        UARTSend("usage: set <name> <value>\r\n");
+        return;
+    }
+    *valueStr++ = '\0';
+
+    paramId_t id = findParam(args);
+    if (id == NUM_PARAMS) {
+        UARTSend("unknown parameter\r\n");
+    } else if (!parseValue(valueStr, params[id].type, &value) || !setParam(id, value)) {
+        UARTSend("bad value\r\n");
+    } else {
+        sendParam(id);
+    }
+}
+
+//
+// Saves the parameters to EEPROM
+//
+static void saveCommand(char *args)
+{
+    UARTSend(saveParams() ? "saved\r\n" : "save failed\r\n");
+}
+
+//
+// Puts all parameters back to their defaults
+//
+static void defaultsCommand(char *args)
+{
+    uint8_t i;
+    for (i = 0; i < NUM_PARAMS; i++) {
+        if (params[i].value != NULL) {
+            setParam((paramId_t)i, params[i].defaultValue);
+        }
+    }
+    UARTSend("defaults restored\r\n");
+}
@@ -0,0 +1,104 @@
+//*****************************************************************************
+//
+// params.h - Runtime parameter store.  Tuning constants are registered by
+// their modules with a range and default, can be read and changed over
+// serial while flying, and are saved to EEPROM.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#ifndef PARAMS_H_
+#define PARAMS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//
+// Parameter IDs.  The ID is also the parameter's slot in EEPROM, so only
+// add new parameters to the end.
+//
+enum paramIds {
+    PARAM_ALT_KP_LOW = 0, PARAM_ALT_KI_LOW, PARAM_ALT_KD_LOW,
+    PARAM_ALT_KP_MID, PARAM_ALT_KI_MID, PARAM_ALT_KD_MID,
+    PARAM_ALT_KP_HIGH, PARAM_ALT_KI_HIGH, PARAM_ALT_KD_HIGH,
+    PARAM_YAW_KP, PARAM_YAW_KI, PARAM_YAW_KD,
+    PARAM_ALT_RANGE,
+    PARAM_YAW_SLOTS,
+    PARAM_MAX_DUTY, PARAM_MAX_TAIL_DUTY, PARAM_MAIN_MIN_DUTY, PARAM_TAIL_MIN_DUTY,
+    PARAM_ALT_D_MEAS, PARAM_ALT_D_CUTOFF, PARAM_YAW_D_MEAS, PARAM_YAW_D_CUTOFF,
+    PARAM_CONTROL_SYNC, PARAM_SYNC_SAMPLES,
+    PARAM_CONTROL_MODE,
+    PARAM_PWM_SYNC,
+    PARAM_MAIN_SLEW, PARAM_MAIN_ACCEL, PARAM_TAIL_SLEW, PARAM_TAIL_ACCEL,
+    PARAM_MAIN_PWM_FREQ, PARAM_TAIL_PWM_FREQ,
+    PARAM_MAIN_LIN_0, PARAM_MAIN_LIN_1, PARAM_MAIN_LIN_2,
+    PARAM_MAIN_LIN_3, PARAM_MAIN_LIN_4, PARAM_MAIN_LIN_5,
+    PARAM_TAIL_LIN_0, PARAM_TAIL_LIN_1, PARAM_TAIL_LIN_2,
+    PARAM_TAIL_LIN_3, PARAM_TAIL_LIN_4, PARAM_TAIL_LIN_5,
+    PARAM_BAUD_RATE, PARAM_TEL_MODE, PARAM_TEL_RATE,
+    PARAM_BB_PRE, PARAM_BB_TRIGGERS, PARAM_DISPLAY_MODE,
+    PARAM_FF_HOVER_0, PARAM_FF_HOVER_1, PARAM_FF_HOVER_2, PARAM_FF_HOVER_3,
+    PARAM_FF_HOVER_4, PARAM_FF_HOVER_5, PARAM_FF_HOVER_6, PARAM_FF_HOVER_7,
+    PARAM_FF_HOVER_8, PARAM_FF_HOVER_9, PARAM_FF_HOVER_10,
+    PARAM_FF_TAIL_0, PARAM_FF_TAIL_1, PARAM_FF_TAIL_2, PARAM_FF_TAIL_3,
+    PARAM_FF_TAIL_4, PARAM_FF_TAIL_5, PARAM_FF_TAIL_6, PARAM_FF_TAIL_7,
+    PARAM_FF_TAIL_8, PARAM_FF_TAIL_9, PARAM_FF_TAIL_10,
+    NUM_PARAMS
+};
+typedef enum paramIds paramId_t;
+
+//
+// Parameter value types, fixed values are Q16.16
+//
+enum paramTypes {PARAM_INT = 0, PARAM_FIXED};
+typedef enum paramTypes paramType_t;
+
+//
+// A registered parameter
+//
+typedef struct {
+    const char *name;
+    paramType_t type;
+    int32_t *value;             // Module variable the parameter controls
+    int32_t min;
+    int32_t max;
+    int32_t defaultValue;       // Value of the variable when registered
+    void (*onChange)(void);     // Called after the value changes, can be NULL
+} param_t;
+
+//
+// Initialises the parameter store and its serial commands
+//
+void initParams(void);
+
+//
+// Registers a module variable as a parameter.  Its current value becomes
+// the default.
+//
+void registerParam(paramId_t id, const char *name, paramType_t type, int32_t *value,
+                   int32_t min, int32_t max, void (*onChange)(void));
+
+//
+// Loads the saved parameters from EEPROM, call once all are registered.
+// Anything missing or out of range keeps its default.
+//
+void loadParams(void);
+
+//
+// Saves all parameters to EEPROM, returns false if it failed
+//
+bool saveParams(void);
+
+//
+// Sets a parameter, returns false if the value is out of range
+//
+bool setParam(paramId_t id, int32_t value);
+
+//
+// Gets the value of a parameter
+//
+int32_t getParam(paramId_t id);
+
+#endif /*PARAMS_H_*/
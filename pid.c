@@ -0,0 +1,262 @@
+//*****************************************************************************
+//
+// pid.c - Reusable PID controller.  Runs in Q16.16 fixed point by default,
+// or in float when built with PID_FLOAT defined (for comparison).
+// Supports clamping or back-calculation anti-windup and a low pass
+// filtered derivative on error or on measurement.  Output slew limiting
+// is left to the shaper.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "timer.h"
+#include "pid.h"
+
+// Default limit, kept well inside Q16.16 range so sums can't overflow
+#define PID_NO_LIMIT PID_FROM_INT(10000)
+
+#define PID_TWO_PI PID_FROM_FLOAT(6.28319f)
+
+// Altitude errors fed to the PID by the benchmark, in %
+static const int8_t benchErrors[] = {12, 9, 5, 2, 0, -1, -3, -2, -1, 0, 1, 0};
+#define NUM_BENCH_ERRORS (sizeof(benchErrors) / sizeof(benchErrors[0]))
+
+//
+// Limits a value to the given range
+//
+static pidNum_t clampPID(pidNum_t value, pidNum_t min, pidNum_t max)
+{
+    if (value > max) {
+        return max;
+    } else if (value < min) {
+        return min;
+    }
+    return value;
+}
+
+//
+// Initialises a PID with the given gains, no limits and a cleared state
+//
+void PID_API(initPID)(pidCtrl_t *pid, pidNum_t kp, pidNum_t ki, pidNum_t kd)
+{
+    PID_API(setPIDGains)(pid, kp, ki, kd);
+    pid->kb = 0;
+    pid->outMin = -PID_NO_LIMIT;
+    pid->outMax = PID_NO_LIMIT;
+    pid->iMin = -PID_NO_LIMIT;
+    pid->iMax = PID_NO_LIMIT;
+    pid->dOnMeasurement = false;
+    pid->rateRef = 0;
+    pid->dCutoff = 0;
+    pid->wrap = 0;
+    PID_API(resetPID)(pid);
+}
+
+//
+// Sets the PID gains, keeping the current state
+//
+void PID_API(setPIDGains)(pidCtrl_t *pid, pidNum_t kp, pidNum_t ki, pidNum_t kd)
+{
+    pid->kp = kp;
+    pid->ki = ki;
+    pid->kd = kd;
+}
+
+//
+// Sets the min/max output of the PID
+//
+void PID_API(setPIDLimits)(pidCtrl_t *pid, pidNum_t outMin, pidNum_t outMax)
+{
+    pid->outMin = outMin;
+    pid->outMax = outMax;
+}
+
+//
+// Sets the min/max value of the integral
+//
+void PID_API(setPIDIntegralLimits)(pidCtrl_t *pid, pidNum_t iMin, pidNum_t iMax)
+{
+    pid->iMin = iMin;
+    pid->iMax = iMax;
+    pid->integral = clampPID(pid->integral, iMin, iMax);
+}
+
+//
+// Sets the back-calculation anti-windup gain, 0 uses clamping instead
+//
+void PID_API(setPIDBackCalculation)(pidCtrl_t *pid, pidNum_t kb)
+{
+    pid->kb = kb;
+}
+
+//
+// Selects derivative on measurement (true) or on error (false)
+//
+void PID_API(setPIDDerivativeOnMeasurement)(pidCtrl_t *pid, bool enable)
+{
+    pid->dOnMeasurement = enable;
+}
+
+//
+// Sets the cutoff of the low pass filter on the derivative
+//
+void PID_API(setPIDDerivativeFilter)(pidCtrl_t *pid, pidNum_t cutoff)
+{
+    pid->dCutoff = cutoff;
+}
+
+//
+// Sets the range of an angular measurement
+//
+void PID_API(setPIDMeasurementWrap)(pidCtrl_t *pid, pidNum_t wrap)
+{
+    pid->wrap = wrap;
+}
+
+//
+// Sets the rate the measurement should be changing at
+//
+void PID_API(setPIDRateReference)(pidCtrl_t *pid, pidNum_t rateRef)
+{
+    pid->rateRef = rateRef;
+}
+
+//
+// Clears the integral and derivative history of the PID
+//
+void PID_API(resetPID)(pidCtrl_t *pid)
+{
+    pid->integral = 0;
+    pid->prevError = 0;
+    pid->prevMeasurement = 0;
+    pid->rate = 0;
+    pid->output = 0;
+    pid->primed = false;
+    pid->saturated = false;
+}
+
+//
+// Clears the integral of the PID
+//
+void PID_API(resetPIDIntegral)(pidCtrl_t *pid)
+{
+    pid->integral = 0;
+}
+
+//
+// Takes over from whatever was driving the output, for a bumpless start
+//
+void PID_API(primePID)(pidCtrl_t *pid, pidNum_t output, pidNum_t error, pidNum_t measurement)
+{
+    pid->integral = clampPID(output - PID_MUL(pid->kp, error), pid->iMin, pid->iMax);
+    pid->prevError = error;
+    pid->prevMeasurement = measurement;
+    pid->rate = 0;
+    pid->output = clampPID(output, pid->outMin, pid->outMax);
+    pid->primed = true;
+    pid->saturated = false;
+}
+
+//
+// Adds delta to the integral of the PID, within the integral limits
+//
+void PID_API(adjustPIDIntegral)(pidCtrl_t *pid, pidNum_t delta)
+{
+    pid->integral = clampPID(pid->integral + delta, pid->iMin, pid->iMax);
+}
+
+//
+// Runs one PID step and returns the limited output
+//
+pidNum_t PID_API(updatePID)(pidCtrl_t *pid, pidNum_t error, pidNum_t measurement, pidNum_t dt)
+{
+    pidNum_t P = PID_MUL(pid->kp, error);
+    pidNum_t dI = PID_MUL(PID_MUL(pid->ki, error), dt);
+    pidNum_t D = 0;
+
+    // No derivative until there is a previous sample, avoids a start up kick
+    if (pid->primed && dt > 0) {
+        pidNum_t rate;
+        if (pid->dOnMeasurement) {
+            pidNum_t change = measurement - pid->prevMeasurement;
+            if (pid->wrap > 0) {
+                if (change >= pid->wrap / 2) {
+                    change -= pid->wrap;
+                } else if (change < -pid->wrap / 2) {
+                    change += pid->wrap;
+                }
+            }
+            rate = PID_DIV(change, dt);
+        } else {
+            rate = PID_DIV(error - pid->prevError, dt);
+        }
+
+        // First order low pass, alpha = dt / (tau + dt) with tau = 1 / (2 pi fc)
+        if (pid->dCutoff > 0) {
+            pidNum_t tau = PID_DIV(PID_ONE, PID_MUL(PID_TWO_PI, pid->dCutoff));
+            pidNum_t alpha = PID_DIV(dt, tau + dt);
+            pid->rate += PID_MUL(alpha, rate - pid->rate);
+        } else {
+            pid->rate = rate;
+        }
+
+        if (pid->dOnMeasurement) {
+            D = PID_MUL(pid->kd, pid->rateRef - pid->rate);
+        } else {
+            D = PID_MUL(pid->kd, pid->rate);
+        }
+    }
+
+    pidNum_t integral = clampPID(pid->integral + dI, pid->iMin, pid->iMax);
+    pidNum_t unlimited = P + integral + D;
+    pidNum_t output = clampPID(unlimited, pid->outMin, pid->outMax);
+
+    // Anti-windup
+    if (pid->kb > 0) {
+        // Back-calculation, bleeds the integral by the amount clipped
+        integral += PID_MUL(PID_MUL(pid->kb, output - unlimited), dt);
+        pid->integral = clampPID(integral, pid->iMin, pid->iMax);
+    } else if (!((output < unlimited && error > 0) || (output > unlimited && error < 0))) {
+        // Clamping, only integrates when not limited in the error's direction
+        pid->integral = integral;
+    }
+
+    pid->saturated = (output != unlimited);
+    pid->prevError = error;
+    pid->prevMeasurement = measurement;
+    pid->output = output;
+    pid->primed = true;
+
+    return output;
+}
+
+//
+// Times updatePID on a PID set up like the altitude loop, returns the
+// average in timer ticks
+//
+uint32_t PID_API(timePIDUpdate)(uint16_t runs)
+{
+    pidCtrl_t pid;
+    pidNum_t dt = PID_FROM_FLOAT(0.01f);
+    uint32_t start;
+    uint16_t i;
+
+    PID_API(initPID)(&pid, PID_FROM_FLOAT(1.2f), PID_FROM_INT(2), PID_FROM_FLOAT(0.1f));
+    PID_API(setPIDLimits)(&pid, PID_FROM_INT(10), PID_FROM_INT(90));
+    PID_API(setPIDIntegralLimits)(&pid, PID_FROM_INT(-50), PID_FROM_INT(50));
+    PID_API(setPIDBackCalculation)(&pid, PID_FROM_INT(1));
+    PID_API(setPIDDerivativeOnMeasurement)(&pid, true);
+    PID_API(setPIDDerivativeFilter)(&pid, PID_FROM_INT(20));
+
+    start = getTimestamp();
+    for (i = 0; i < runs; i++) {
+        pidNum_t error = PID_FROM_INT(benchErrors[i % NUM_BENCH_ERRORS]);
+        PID_API(updatePID)(&pid, error, PID_FROM_INT(50) - error, dt);
+    }
+    return (getTimestamp() - start) / runs;
+}
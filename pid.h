@@ -0,0 +1,181 @@
+//*****************************************************************************
+//
+// pid.h - Reusable PID controller.  Runs in Q16.16 fixed point by default,
+// or in float when built with PID_FLOAT defined (for comparison).
+// Supports clamping or back-calculation anti-windup and a low pass
+// filtered derivative on error or on measurement.  Output slew limiting
+// is left to the shaper.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#ifndef PID_H_
+#define PID_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Name of each PID function.  pidbench.c builds pid.c a second time with
+// PID_FLOAT flipped and renames the whole API through this, so every
+// function here has to be declared, defined and called within pid.c
+// through it.
+#ifndef PID_API
+#define PID_API(name) name
+#endif
+
+// Q16.16 constant, used to store PID constants in the same format
+// whichever way the PID is built
+#define Q16_FROM_FLOAT(x)   ((int32_t)((x) * 65536.0f + ((x) >= 0 ? 0.5f : -0.5f)))
+
+#ifdef PID_FLOAT
+//
+// Float build
+//
+typedef float pidNum_t;
+#define PID_ONE             1.0f
+#define PID_FROM_INT(x)     ((pidNum_t)(x))
+#define PID_FROM_FLOAT(x)   ((pidNum_t)(x))
+#define PID_TO_INT(x)       ((int32_t)(x))
+#define PID_TO_FLOAT(x)     ((float)(x))
+#define PID_MUL(a, b)       ((a) * (b))
+#define PID_DIV(a, b)       ((a) / (b))
+#define PID_FROM_RATIO(n, d) ((pidNum_t)(n) / (pidNum_t)(d))
+#define PID_FROM_Q16(x)     ((pidNum_t)(x) / 65536.0f)
+#define PID_TO_Q16(x)       ((int32_t)((x) * 65536.0f))
+#else
+//
+// Q16.16 fixed point build
+//
+typedef int32_t pidNum_t;
+#define PID_FRAC_BITS       16
+#define PID_ONE             ((pidNum_t)1 << PID_FRAC_BITS)
+#define PID_FROM_INT(x)     ((pidNum_t)(x) * PID_ONE)
+#define PID_FROM_FLOAT(x)   ((pidNum_t)((x) * 65536.0f + ((x) >= 0 ? 0.5f : -0.5f)))
+#define PID_TO_INT(x)       ((int32_t)((x) / PID_ONE))
+#define PID_TO_FLOAT(x)     ((float)(x) / 65536.0f)
+#define PID_MUL(a, b)       ((pidNum_t)(((int64_t)(a) * (b)) >> PID_FRAC_BITS))
+#define PID_DIV(a, b)       ((pidNum_t)(((int64_t)(a) << PID_FRAC_BITS) / (b)))
+#define PID_FROM_RATIO(n, d) ((pidNum_t)(((int64_t)(n) << PID_FRAC_BITS) / (d)))
+#define PID_FROM_Q16(x)     ((pidNum_t)(x))
+#define PID_TO_Q16(x)       ((int32_t)(x))
+#endif
+
+//
+// PID controller gains, limits and state
+//
+typedef struct {
+    // Gains
+    pidNum_t kp;
+    pidNum_t ki;
+    pidNum_t kd;
+    pidNum_t kb;            // Back-calculation gain, 0 uses clamping
+
+    // Limits
+    pidNum_t outMin;
+    pidNum_t outMax;
+    pidNum_t iMin;
+    pidNum_t iMax;
+
+    // Differentiate the measurement instead of the error
+    bool dOnMeasurement;
+    pidNum_t rateRef;       // Rate reference for derivative on measurement
+    pidNum_t dCutoff;       // Derivative filter cutoff in Hz, 0 is unfiltered
+    pidNum_t wrap;          // Range of an angular measurement, 0 if it doesn't wrap
+
+    // State
+    pidNum_t integral;
+    pidNum_t prevError;
+    pidNum_t prevMeasurement;
+    pidNum_t rate;          // Filtered rate of the error or measurement
+    pidNum_t output;
+    bool primed;            // Set once prev values are valid
+    bool saturated;         // Output was limited on the last update
+} pidCtrl_t;
+
+//
+// Initialises a PID with the given gains, no limits and a cleared state
+//
+void PID_API(initPID)(pidCtrl_t *pid, pidNum_t kp, pidNum_t ki, pidNum_t kd);
+
+//
+// Sets the PID gains, keeping the current state
+//
+void PID_API(setPIDGains)(pidCtrl_t *pid, pidNum_t kp, pidNum_t ki, pidNum_t kd);
+
+//
+// Sets the min/max output of the PID
+//
+void PID_API(setPIDLimits)(pidCtrl_t *pid, pidNum_t outMin, pidNum_t outMax);
+
+//
+// Sets the min/max value of the integral
+//
+void PID_API(setPIDIntegralLimits)(pidCtrl_t *pid, pidNum_t iMin, pidNum_t iMax);
+
+//
+// Sets the back-calculation anti-windup gain, 0 uses clamping instead
+//
+void PID_API(setPIDBackCalculation)(pidCtrl_t *pid, pidNum_t kb);
+
+//
+// Selects derivative on measurement (true) or on error (false)
+//
+void PID_API(setPIDDerivativeOnMeasurement)(pidCtrl_t *pid, bool enable);
+
+//
+// Sets the cutoff of the first order low pass filter on the derivative,
+// in Hz.  0 turns the filter off.
+//
+void PID_API(setPIDDerivativeFilter)(pidCtrl_t *pid, pidNum_t cutoff);
+
+//
+// Sets the range of an angular measurement (e.g. 360 degrees) so the
+// derivative on measurement ignores it wrapping around.  0 for none.
+//
+void PID_API(setPIDMeasurementWrap)(pidCtrl_t *pid, pidNum_t wrap);
+
+//
+// Sets the rate the measurement should be changing at, used by the
+// derivative on measurement so a moving reference isn't damped
+//
+void PID_API(setPIDRateReference)(pidCtrl_t *pid, pidNum_t rateRef);
+
+//
+// Clears the integral and derivative history of the PID
+//
+void PID_API(resetPID)(pidCtrl_t *pid);
+
+//
+// Clears the integral of the PID
+//
+void PID_API(resetPIDIntegral)(pidCtrl_t *pid);
+
+//
+// Takes over from whatever was driving the output, for a bumpless start.
+// The integral is set so the next output matches the one being applied
+// at the current error, and the previous error
+// and measurement to the current ones so the derivative doesn't kick.
+//
+void PID_API(primePID)(pidCtrl_t *pid, pidNum_t output, pidNum_t error, pidNum_t measurement);
+
+//
+// Adds delta to the integral of the PID, within the integral limits
+//
+void PID_API(adjustPIDIntegral)(pidCtrl_t *pid, pidNum_t delta);
+
+//
+// Runs one PID step and returns the limited output.  The error is passed
+// separately from the measurement so wrapping errors (yaw) can be handled
+// by the caller.
+//
+pidNum_t PID_API(updatePID)(pidCtrl_t *pid, pidNum_t error, pidNum_t measurement, pidNum_t dt);
+
+//
+// Times updatePID on a PID set up like the altitude loop, returns the
+// average in timer ticks over the given number of runs
+//
+uint32_t PID_API(timePIDUpdate)(uint16_t runs);
+
+#endif /*PID_H_*/
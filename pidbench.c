@@ -0,0 +1,75 @@
+//*****************************************************************************
+//
+// pidbench.c - Times the PID in Q16.16 fixed point against float, on
+// target.  pid.c is built a second time here the other way round from
+// the rest of the firmware (PID_FLOAT flipped), with its functions
+// renamed through PID_API, so both versions run on the same build.
+//
+// Serial commands:
+//   pidbench   - prints the cycles per updatePID of each version
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "utils/ustdlib.h"
+
+#include "serial.h"
+#include "pidbench.h"
+
+#define MAX_STR_LEN 40
+
+// PID updates per run of the benchmark
+#define PID_BENCH_RUNS 256
+
+// The firmware's PID and the other build of it, below
+uint32_t timePIDUpdate(uint16_t runs);
+uint32_t timePIDUpdateOther(uint16_t runs);
+
+//
+// Prints the cycles per updatePID of the fixed point and float PIDs
+//
+static void pidbenchCommand(char *args)
+{
+    char string[MAX_STR_LEN + 1];
+    uint32_t fixedTicks;
+    uint32_t floatTicks;
+
+#ifdef PID_FLOAT
+    floatTicks = timePIDUpdate(PID_BENCH_RUNS);
+    fixedTicks = timePIDUpdateOther(PID_BENCH_RUNS);
+#else
+    fixedTicks = timePIDUpdate(PID_BENCH_RUNS);
+    floatTicks = timePIDUpdateOther(PID_BENCH_RUNS);
+#endif
+
+    // Timer ticks are CPU cycles
+    usnprintf(string, sizeof(string), "fixed=%d cycles\r\n", fixedTicks);
+    UARTSend(string);
+    usnprintf(string, sizeof(string), "float=%d cycles\r\n", floatTicks);
+    UARTSend(string);
+}
+
+//
+// Registers the pidbench command
+//
+void initPIDBench(void)
+{
+    registerCommand("pidbench", pidbenchCommand);
+}
+
+//
+// The other build of the PID, renamed so it doesn't clash with pid.c
+//
+#ifdef PID_FLOAT
+#undef PID_FLOAT
+#else
+#define PID_FLOAT
+#endif
+
+#define PID_API(name) name##Other
+
+#include "pid.c"
@@ -0,0 +1,19 @@
+//*****************************************************************************
+//
+// pidbench.h - Times the PID in Q16.16 fixed point against float, on
+// target, with the pidbench serial command
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#ifndef PIDBENCH_H_
+#define PIDBENCH_H_
+
+//
+// Registers the pidbench command
+//
+void initPIDBench(void);
+
+#endif /*PIDBENCH_H_*/
@@ -1,16 +1,27 @@
 //*****************************************************************************
 //
-// PWM.c - Module for controlling the helicopter's motor's PWM cycles
+// PWM.c - Module for controlling the helicopter's motor's PWM cycles.
+// Both generators use global sync, so new periods and duties only take
+// effect at a period boundary once committed.  With pwm_sync set, duties
+// written between beginPWMUpdate and commitPWMUpdate are committed for
+// both rotors together.
+//
+// Each rotor's frequency is a parameter.  The generators share one PWM
+// clock divider, picked as the smallest that fits both periods in the
+// counter.  Commanded efforts go through a per-rotor compensation table
+// that maps them to duty, to take out the motors' dead zone and bends.
 //
 // Author:  bma206, tki36
-// Last modified:   12.5.2024
+// Last modified:   19.10.2026
 //
 //*****************************************************************************
 
 #include <stdint.h>
+#include <stddef.h>
 #include <stdbool.h>
 #include "inc/hw_memmap.h"
 #include "inc/hw_types.h"
+#include "inc/hw_ints.h"
 #include "driverlib/pin_map.h" //Needed for pin configure
 #include "driverlib/debug.h"
 #include "driverlib/gpio.h"
@@ -19,16 +30,42 @@
 #include "driverlib/sysctl.h"
 #include "driverlib/interrupt.h"
 #include "pwm.h"
+#include "params.h"
+#include "latency.h"
+#include "lookup.h"
+
+//
+// PWM clock dividers, shared by all generators
+//
+typedef struct {
+    uint32_t code;
+    uint32_t divider;
+} pwmDivider_t;
 
+static const pwmDivider_t pwmDividers[] = {
+    {SYSCTL_PWMDIV_1, 1}, {SYSCTL_PWMDIV_2, 2}, {SYSCTL_PWMDIV_4, 4}, {SYSCTL_PWMDIV_8, 8},
+    {SYSCTL_PWMDIV_16, 16}, {SYSCTL_PWMDIV_32, 32}, {SYSCTL_PWMDIV_64, 64},
+};
+#define NUM_PWM_DIVIDERS (sizeof(pwmDividers) / sizeof(pwmDividers[0]))
 
-#define PWM_DIVIDER_CODE   SYSCTL_PWMDIV_4
-#define PWM_DIVIDER        4
+// Longest period in up/down mode, the load register is half of it and
+// 16 bits
+#define PWM_MAX_PERIOD 131070
+
+// Allowed frequencies.  The lowest still fits with the biggest divider.
+// The highest is 2000 ticks per period at the 20 MHz clock, and as the
+// counter counts up then down that is 1000 width steps.
+#define MIN_PWM_FREQUENCY 10
+#define MAX_PWM_FREQUENCY 10000
 
 // Main rotor pwm pin/output config
 #define PWM_MAIN_BASE	     PWM0_BASE
 #define PWM_MAIN_GEN         PWM_GEN_3
 #define PWM_MAIN_OUTNUM      PWM_OUT_7
 #define PWM_MAIN_OUTBIT      PWM_OUT_7_BIT
+#define PWM_MAIN_GENBIT      PWM_GEN_3_BIT
+#define PWM_MAIN_INT         PWM_INT_GEN_3
+#define PWM_MAIN_INT_VECTOR  INT_PWM0_3
 #define PWM_MAIN_PERIPH_PWM	 SYSCTL_PERIPH_PWM0
 #define PWM_MAIN_PERIPH_GPIO SYSCTL_PERIPH_GPIOC
 #define PWM_MAIN_GPIO_BASE   GPIO_PORTC_BASE
@@ -36,11 +73,16 @@
 #define PWM_MAIN_GPIO_PIN    GPIO_PIN_5
 #define PWM_MAIN_FREQUENCY   250
 
+// Period interrupt priority, below the sensor interrupts but above the
+// deferred control interrupt it pends
+#define PWM_INT_PRIORITY     0x40
+
 // Tail rotor pwm pin/output config
 #define PWM_TAIL_BASE	     PWM1_BASE
 #define PWM_TAIL_GEN         PWM_GEN_2
 #define PWM_TAIL_OUTNUM      PWM_OUT_5
 #define PWM_TAIL_OUTBIT      PWM_OUT_5_BIT
+#define PWM_TAIL_GENBIT      PWM_GEN_2_BIT
 #define PWM_TAIL_PERIPH_PWM	 SYSCTL_PERIPH_PWM1
 #define PWM_TAIL_PERIPH_GPIO SYSCTL_PERIPH_GPIOF
 #define PWM_TAIL_GPIO_BASE   GPIO_PORTF_BASE
@@ -48,39 +90,309 @@
 #define PWM_TAIL_GPIO_PIN    GPIO_PIN_1
 #define PWM_TAIL_FREQUENCY   250
 
+// PWM frequencies, set as parameters
+static int32_t mainFrequency = PWM_MAIN_FREQUENCY;
+static int32_t tailFrequency = PWM_TAIL_FREQUENCY;
+
+// Divider in use
+static uint32_t pwmDivider = 1;
+
+// Effort to duty compensation, duty % at evenly spaced effort %.  The
+// defaults are a straight line, replace them with measured points.
+#define LIN_POINTS  6
+#define LIN_STEP    20
+static int32_t mainLinear[LIN_POINTS] = {
+    Q16_FROM_FLOAT(0.0f), Q16_FROM_FLOAT(20.0f), Q16_FROM_FLOAT(40.0f),
+    Q16_FROM_FLOAT(60.0f), Q16_FROM_FLOAT(80.0f), Q16_FROM_FLOAT(100.0f),
+};
+static int32_t tailLinear[LIN_POINTS] = {
+    Q16_FROM_FLOAT(0.0f), Q16_FROM_FLOAT(20.0f), Q16_FROM_FLOAT(40.0f),
+    Q16_FROM_FLOAT(60.0f), Q16_FROM_FLOAT(80.0f), Q16_FROM_FLOAT(100.0f),
+};
+static const char *mainLinearNames[LIN_POINTS] = {
+    "main_lin0", "main_lin20", "main_lin40", "main_lin60", "main_lin80", "main_lin100"
+};
+static const char *tailLinearNames[LIN_POINTS] = {
+    "tail_lin0", "tail_lin20", "tail_lin40", "tail_lin60", "tail_lin80", "tail_lin100"
+};
+static lookupTable_t mainTable;
+static lookupTable_t tailTable;
+
+// Min/max duty cycles for the main and tail rotor
+int32_t MAX_DUTY = 98;
+int32_t MAX_TAIL_DUTY = 75;
+int32_t MAIN_MIN_DUTY = 2;
+int32_t TAIL_MIN_DUTY = 2;
+
+//
+// A rotor's PWM output.  The period only changes with the frequency, so
+// it is worked out then and the pulse width is only written when it
+// changes.
+//
+typedef struct {
+    uint32_t base;
+    uint32_t gen;
+    uint32_t genBit;
+    uint32_t outNum;
+    const lookupTable_t *table;     // Effort to duty compensation
+    uint32_t period;        // PWM clock ticks
+    uint32_t width;         // Pulse width last written, in ticks
+    int32_t effort;         // Q15 commanded effort
+    int32_t duty;           // Q15 fraction of the period, after compensation
+    bool pending;           // Width written but not committed
+} pwmChannel_t;
+
+static pwmChannel_t mainPWM = {PWM_MAIN_BASE, PWM_MAIN_GEN, PWM_MAIN_GENBIT, PWM_MAIN_OUTNUM,
+                               &mainTable, 0, 0, 0, 0, false};
+static pwmChannel_t tailPWM = {PWM_TAIL_BASE, PWM_TAIL_GEN, PWM_TAIL_GENBIT, PWM_TAIL_OUTNUM,
+                               &tailTable, 0, 0, 0, 0, false};
+
+// 1 commits staged duties for both rotors together, 0 commits each as
+// it is written
+static int32_t pwmSync = 1;
+static bool pwmStaging = false;
+
+// Called at the start of every main rotor PWM period, can be NULL
+static void (*periodHandler)(void) = NULL;
+
+//
+// Commits a channel's written pulse width at its next period boundary
+//
+static void commitPWMChannel(pwmChannel_t *channel)
+{
+    if (channel->pending) {
+        PWMSyncUpdate(channel->base, channel->genBit);
+        channel->pending = false;
+    }
+}
+
+//
+// Handles the main rotor PWM counter reaching zero
+//
+static void PWMIntHandler(void)
+{
+    PWMGenIntClear(PWM_MAIN_BASE, PWM_MAIN_GEN, PWM_INT_CNT_ZERO);
+
+    if (periodHandler != NULL) {
+        periodHandler();
+    }
+}
+
+//
+// Writes a channel's pulse width for its duty if it changed.  The width is
+// committed now unless an update is being staged.
+//
+static void writePWMWidth(pwmChannel_t *channel)
+{
+    // Pulse width must be below the period
+    uint32_t width = ((uint64_t)channel->period * channel->duty) >> PWM_DUTY_BITS;
+    if (width >= channel->period) {
+        width = channel->period - 1;
+    }
+
+    if (width != channel->width) {
+        PWMPulseWidthSet(channel->base, channel->outNum, width);
+        channel->width = width;
+        channel->pending = true;
+    }
+
+    if (!pwmStaging) {
+        commitPWMChannel(channel);
+    }
+}
+
+//
+// Sets the period of a channel from its frequency, keeping its duty
+//
+static void setPWMFrequency(pwmChannel_t *channel, uint32_t frequency)
+{
+    channel->period = SysCtlClockGet() / pwmDivider / frequency;
+    PWMGenPeriodSet(channel->base, channel->gen, channel->period);
+    channel->width = channel->period;   // Forces the width to be rewritten
+    channel->pending = true;
+    writePWMWidth(channel);
+}
+
+//
+// Picks the smallest divider that fits both periods, then sets the
+// frequencies of both rotors
+//
+static void applyPWMFrequencies(void)
+{
+    uint32_t clock = SysCtlClockGet();
+    uint32_t lowest = (mainFrequency < tailFrequency) ? mainFrequency : tailFrequency;
+    uint8_t i = 0;
+    bool masked = IntMasterDisable();
+
+    while (i + 1 < NUM_PWM_DIVIDERS && clock / pwmDividers[i].divider / lowest > PWM_MAX_PERIOD) {
+        i++;
+    }
+    SysCtlPWMClockSet(pwmDividers[i].code);
+    pwmDivider = pwmDividers[i].divider;
+
+    setPWMFrequency(&mainPWM, mainFrequency);
+    setPWMFrequency(&tailPWM, tailFrequency);
+    if (!masked) {
+        IntMasterEnable();
+    }
+}
+
+//
+// Rebuilds the compensation tables from their parameters
+//
+static void applyLinearisation(void)
+{
+    uint8_t i;
+    bool masked = IntMasterDisable();
+
+    mainTable.size = LIN_POINTS;
+    tailTable.size = LIN_POINTS;
+    for (i = 0; i < LIN_POINTS; i++) {
+        mainTable.x[i] = PID_FROM_INT(i * LIN_STEP);
+        mainTable.y[i] = PID_FROM_Q16(mainLinear[i]);
+        tailTable.x[i] = PID_FROM_INT(i * LIN_STEP);
+        tailTable.y[i] = PID_FROM_Q16(tailLinear[i]);
+    }
+    if (!masked) {
+        IntMasterEnable();
+    }
+}
+
+//
+// Limits a channel's effort to the given percentages, compensates it and
+// writes the pulse width.  Masked, as the kernel and the synced control
+// interrupt both write the channels.
+//
+static void setPWMEffort(pwmChannel_t *channel, int32_t effort, int32_t minPercent, int32_t maxPercent)
+{
+    int32_t maxEffort = PWM_DUTY_FROM_PERCENT(maxPercent);
+    int32_t minEffort = PWM_DUTY_FROM_PERCENT(minPercent);
+    bool masked = IntMasterDisable();
 
+    // Check the effort isn't out of range
+    if (effort > maxEffort) {
+        effort = maxEffort;
+    } else if (effort < minEffort) {
+        effort = minEffort;
+    }
+    channel->effort = effort;
 
-// Current tail and main rotor pwm
-static int32_t mainPower = 0;
-static int32_t tailPower = 0;
+    // Effort % through the table to duty %, then back to Q15
+    pidNum_t percent = PID_FROM_RATIO(effort * 100, PWM_DUTY_ONE);
+    int32_t duty = PID_TO_Q16(interpolateTable(channel->table, percent)) / 200;
+    if (duty < 0) {
+        duty = 0;
+    } else if (duty > PWM_DUTY_ONE) {
+        duty = PWM_DUTY_ONE;
+    }
+    channel->duty = duty;
 
-#define MAX_TAIL_CHANGE 5
+    writePWMWidth(channel);
+    if (!masked) {
+        IntMasterEnable();
+    }
+}
+
+//
+// Registers the frequency and compensation parameters
+//
+static void registerPWMParams(void)
+{
+    uint8_t i;
+
+    registerParam(PARAM_MAIN_PWM_FREQ, "main_pwm_hz", PARAM_INT, &mainFrequency,
+                  MIN_PWM_FREQUENCY, MAX_PWM_FREQUENCY, applyPWMFrequencies);
+    registerParam(PARAM_TAIL_PWM_FREQ, "tail_pwm_hz", PARAM_INT, &tailFrequency,
+                  MIN_PWM_FREQUENCY, MAX_PWM_FREQUENCY, applyPWMFrequencies);
+
+    for (i = 0; i < LIN_POINTS; i++) {
+        registerParam((paramId_t)(PARAM_MAIN_LIN_0 + i), mainLinearNames[i], PARAM_FIXED,
+                      &mainLinear[i], 0, Q16_FROM_FLOAT(100.0f), applyLinearisation);
+        registerParam((paramId_t)(PARAM_TAIL_LIN_0 + i), tailLinearNames[i], PARAM_FIXED,
+                      &tailLinear[i], 0, Q16_FROM_FLOAT(100.0f), applyLinearisation);
+    }
+}
 
 //
 // Initialises rotors
 //
 void initPWM(void)
 {
-    SysCtlPWMClockSet(PWM_DIVIDER_CODE);
+    applyLinearisation();
 
     // initialise the main rotor
     SysCtlPeripheralEnable(PWM_MAIN_PERIPH_PWM);
     SysCtlPeripheralEnable(PWM_MAIN_PERIPH_GPIO);
     GPIOPinConfigure(PWM_MAIN_GPIO_CONFIG);
     GPIOPinTypePWM(PWM_MAIN_GPIO_BASE, PWM_MAIN_GPIO_PIN);
-    PWMGenConfigure(PWM_MAIN_BASE, PWM_MAIN_GEN, PWM_GEN_MODE_UP_DOWN | PWM_GEN_MODE_NO_SYNC);
-    PWMGenEnable(PWM_MAIN_BASE, PWM_MAIN_GEN);
-    PWMOutputState(PWM_MAIN_BASE, PWM_MAIN_OUTBIT, false);
+    PWMGenConfigure(PWM_MAIN_BASE, PWM_MAIN_GEN, PWM_GEN_MODE_UP_DOWN | PWM_GEN_MODE_SYNC);
 
     // initialise the TAIL rotor
     SysCtlPeripheralEnable(PWM_TAIL_PERIPH_PWM);
     SysCtlPeripheralEnable(PWM_TAIL_PERIPH_GPIO);
     GPIOPinConfigure(PWM_TAIL_GPIO_CONFIG);
     GPIOPinTypePWM(PWM_TAIL_GPIO_BASE, PWM_TAIL_GPIO_PIN);
-    PWMGenConfigure(PWM_TAIL_BASE, PWM_TAIL_GEN, PWM_GEN_MODE_UP_DOWN | PWM_GEN_MODE_NO_SYNC);
+    PWMGenConfigure(PWM_TAIL_BASE, PWM_TAIL_GEN, PWM_GEN_MODE_UP_DOWN | PWM_GEN_MODE_SYNC);
+
+    // Periods and zero duty, before the generators start
+    applyPWMFrequencies();
+    PWMGenEnable(PWM_MAIN_BASE, PWM_MAIN_GEN);
+    PWMOutputState(PWM_MAIN_BASE, PWM_MAIN_OUTBIT, false);
     PWMGenEnable(PWM_TAIL_BASE, PWM_TAIL_GEN);
     PWMOutputState(PWM_TAIL_BASE, PWM_TAIL_OUTBIT, false);
 
+    // Interrupt at the start of each main rotor period, for aligning
+    // control.  It is only triggered while there is a period handler.
+    PWMGenIntRegister(PWM_MAIN_BASE, PWM_MAIN_GEN, PWMIntHandler);
+    IntPrioritySet(PWM_MAIN_INT_VECTOR, PWM_INT_PRIORITY);
+
+    // Duty limits can be tuned over serial
+    registerParam(PARAM_MAX_DUTY, "max_duty", PARAM_INT, &MAX_DUTY, 0, 100, NULL);
+    registerParam(PARAM_MAX_TAIL_DUTY, "max_tail_duty", PARAM_INT, &MAX_TAIL_DUTY, 0, 100, NULL);
+    registerParam(PARAM_MAIN_MIN_DUTY, "main_min_duty", PARAM_INT, &MAIN_MIN_DUTY, 0, 100, NULL);
+    registerParam(PARAM_TAIL_MIN_DUTY, "tail_min_duty", PARAM_INT, &TAIL_MIN_DUTY, 0, 100, NULL);
+    registerParam(PARAM_PWM_SYNC, "pwm_sync", PARAM_INT, &pwmSync, 0, 1, NULL);
+    registerPWMParams();
+}
+
+//
+// Sets a function to call at the start of every main rotor PWM period,
+// from the PWM interrupt.  NULL for none, which turns the interrupt off.
+//
+void setPWMPeriodHandler(void (*handler)(void))
+{
+    if (handler != NULL) {
+        periodHandler = handler;
+        PWMGenIntTrigEnable(PWM_MAIN_BASE, PWM_MAIN_GEN, PWM_INT_CNT_ZERO);
+        PWMIntEnable(PWM_MAIN_BASE, PWM_MAIN_INT);
+    } else {
+        PWMIntDisable(PWM_MAIN_BASE, PWM_MAIN_INT);
+        PWMGenIntTrigDisable(PWM_MAIN_BASE, PWM_MAIN_GEN, PWM_INT_CNT_ZERO);
+        periodHandler = NULL;
+    }
+}
+
+//
+// Starts staging duty updates, if pwm_sync is set
+//
+void beginPWMUpdate(void)
+{
+    pwmStaging = pwmSync;
+}
+
+//
+// Commits the staged duties of both rotors at their next period boundary
+//
+void commitPWMUpdate(void)
+{
+    // Back to back so both land on the same boundary
+    bool masked = IntMasterDisable();
+    commitPWMChannel(&mainPWM);
+    commitPWMChannel(&tailPWM);
+    pwmStaging = false;
+    if (!masked) {
+        IntMasterEnable();
+    }
 }
 
 //
@@ -118,58 +430,67 @@ void stopTailRotor(void)
 }
 
 //
-// Function to set the freq, duty cycle of the main rotor
+// Sets the main rotor's effort, as a Q15 fraction
 //
-void setMainPower (int32_t power)
+void setMainDuty(int32_t duty)
 {
-    int32_t new_power = power;
+    setPWMEffort(&mainPWM, duty, MAIN_MIN_DUTY, MAX_DUTY);
+    markLatency(LAT_MAIN_WRITTEN);
+}
 
-    // Check the power isn't out of range
-    if (power > MAX_DUTY) {
-        new_power = MAX_DUTY;
-    } else if (power < MAIN_MIN_DUTY) {
-        new_power = MAIN_MIN_DUTY;
-    }
+//
+// Sets the tail rotor's effort, as a Q15 fraction
+//
+void setTailDuty(int32_t duty)
+{
+    setPWMEffort(&tailPWM, duty, TAIL_MIN_DUTY, MAX_TAIL_DUTY);
+    markLatency(LAT_TAIL_WRITTEN);
+}
 
-    // Set the new pwm
-    uint32_t pulsePeriod = SysCtlClockGet() / PWM_DIVIDER / PWM_MAIN_FREQUENCY;
-    PWMGenPeriodSet(PWM_MAIN_BASE, PWM_MAIN_GEN, pulsePeriod);
-    PWMPulseWidthSet(PWM_MAIN_BASE, PWM_MAIN_OUTNUM, (pulsePeriod * new_power / 100));
-    mainPower = new_power;
+//
+// Function to set the duty cycle of the main rotor, in %
+//
+void setMainPower (int32_t power)
+{
+    setMainDuty(PWM_DUTY_FROM_PERCENT(power));
 }
 
 //
-// Function to set the freq, duty cycle of the tail rotor
+// Function to set the duty cycle of the tail rotor, in %
 //
 void setTailPower (int32_t power)
 {
-    int32_t new_power = power;
+    setTailDuty(PWM_DUTY_FROM_PERCENT(power));
+}
 
-    // Check the power isn't out of range
-    if (power > MAX_TAIL_DUTY) {
-        new_power = MAX_TAIL_DUTY;
-    } else if (power < TAIL_MIN_DUTY) {
-        new_power = TAIL_MIN_DUTY;
-    }
-    // Set the new pwm
-    uint32_t pulsePeriod = SysCtlClockGet() / PWM_DIVIDER / PWM_TAIL_FREQUENCY;
-    PWMGenPeriodSet(PWM_TAIL_BASE, PWM_TAIL_GEN, pulsePeriod);
-    PWMPulseWidthSet(PWM_TAIL_BASE, PWM_TAIL_OUTNUM, pulsePeriod * new_power / 100);
-    tailPower = new_power;
+//
+// Get the main rotor's effort, as a Q15 fraction
+//
+int32_t getMainDuty(void)
+{
+    return mainPWM.effort;
+}
+
+//
+// Get the tail rotor's effort, as a Q15 fraction
+//
+int32_t getTailDuty(void)
+{
+    return tailPWM.effort;
 }
 
 //
-// Get the main rotor's duty cycle
+// Get the main rotor's effort, rounded to %
 //
 int32_t getMainPower(void)
 {
-    return mainPower;
+    return PWM_DUTY_TO_PERCENT(mainPWM.effort);
 }
 
 //
-// Get the tail rotor's duty cycle
+// Get the tail rotor's effort, rounded to %
 //
 int32_t getTailPower(void)
 {
-    return tailPower;
+    return PWM_DUTY_TO_PERCENT(tailPWM.effort);
 }
@@ -2,22 +2,46 @@
 #define PWM_H_
 //*****************************************************************************
 //
-// PWM.h - Module for controlling the helicopter's motor's PWM cycles
+// PWM.h - Module for controlling the helicopter's motor's PWM cycles.
+// Both generators use global sync, so new periods and duties only take
+// effect at a period boundary once committed.  With pwm_sync set, duties
+// written between beginPWMUpdate and commitPWMUpdate are committed for
+// both rotors together.
 //
 // Author:  bma206, tki36
-// Last modified:   12.5.2024
+// Last modified:   19.10.2026
 //
 //*****************************************************************************
 
 #include <stdint.h>
-// Min/max duty cycles for the main and tail rotor
-static int32_t MAX_DUTY = 98;
-static int32_t MAX_TAIL_DUTY = 75;
-static int32_t MAIN_MIN_DUTY = 2;
-static int32_t TAIL_MIN_DUTY = 2;
+#include <stdbool.h>
+
+// Duty cycles are Q15 fractions of the PWM period, about 0.003% steps.
+// At 250 Hz on the 20 MHz clock a period is 80000 ticks with the /1
+// divider, 40000 width steps up/down, so the Q15 step is the finer limit.
+#define PWM_DUTY_BITS   15
+#define PWM_DUTY_ONE    (1 << PWM_DUTY_BITS)
+#define PWM_DUTY_FROM_PERCENT(p)    ((int32_t)(p) * PWM_DUTY_ONE / 100)
+#define PWM_DUTY_TO_PERCENT(d)      (((int32_t)(d) * 100 + PWM_DUTY_ONE / 2) / PWM_DUTY_ONE)
+
+// Min/max duty cycles for the main and tail rotor, set as parameters
+extern int32_t MAX_DUTY;
+extern int32_t MAX_TAIL_DUTY;
+extern int32_t MAIN_MIN_DUTY;
+extern int32_t TAIL_MIN_DUTY;
 
 void initPWM(void);
 
+// Sets a function to call at the start of every main rotor PWM period,
+// from the PWM interrupt.  NULL for none, which turns the interrupt off.
+void setPWMPeriodHandler(void (*handler)(void));
+
+// Stages the following duty updates, if pwm_sync is set
+void beginPWMUpdate(void);
+
+// Commits the staged duties of both rotors at their next period boundary
+void commitPWMUpdate(void);
+
 void startMainRotor(void);
 
 void stopMainRotor(void);
@@ -26,10 +50,20 @@ void startTailRotor(void);
 
 void stopTailRotor(void);
 
+// Duty as a Q15 fraction of the period, only written when it changes
+void setMainDuty(int32_t duty);
+
+void setTailDuty(int32_t duty);
+
+// Duty in whole %
 void setMainPower(int32_t power);
 
 void setTailPower(int32_t power);
 
+int32_t getMainDuty(void);
+
+int32_t getTailDuty(void);
+
 int32_t getMainPower(void);
 
 int32_t getTailPower(void);
@@ -0,0 +1,316 @@
+//*****************************************************************************
+//
+// recorder.c - Black box flight recorder.  Records a chosen set of the
+// telemetry channels every control update into a RAM ring, keeps a set
+// share of it from before a trigger (a state change, the main rotor
+// saturating or a missed control deadline) and fills the rest after it,
+// then holds the recording until it is dumped over serial, and re-arms.
+//
+// Records are kept packed as they go on the wire, after a timestamp.  The
+// more channels are recorded the fewer records fit.  A dump sends each
+// record as a telemetry frame (TEL_FRAME_RECORD) numbered from the oldest,
+// with its time from the oldest, and pauses telemetry until it is done.
+//
+// Serial commands:
+//   bb                     - prints the recorder state and channels
+//   bb arm                 - clears the recording and starts recording
+//   bb trigger             - triggers the recorder now
+//   bb dump                - sends the held recording as binary frames,
+//                            then re-arms
+//   bb <channel> on|off    - records a telemetry channel or not, re-arms
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "driverlib/interrupt.h"
+#include "utils/ustdlib.h"
+
+#include "altitude.h"
+#include "yaw.h"
+#include "pwm.h"
+#include "flight.h"
+#include "control.h"
+#include "serial.h"
+#include "timer.h"
+#include "kernel.h"
+#include "params.h"
+#include "telemetryFields.h"
+#include "telemetry.h"
+#include "recorder.h"
+
+// Size of the record ring
+#define REC_BUF_SIZE    8192
+#define REC_STAMP_LEN   4
+
+#define MAX_STR_LEN 60
+
+// Triggers the bb_trig parameter can enable, manual is always on
+#define REC_PARAM_TRIGGERS  ((1 << REC_TRIGGER_MANUAL) - 1)
+
+// Channels recorded after a reset
+#define REC_DEFAULT_CHANNELS ((1UL << TEL_YAW) | (1UL << TEL_TARGET_YAW) | (1UL << TEL_ALTITUDE) \
+        | (1UL << TEL_TARGET_ALT) | (1UL << TEL_MAIN_DUTY) | (1UL << TEL_TAIL_DUTY) \
+        | (1UL << TEL_YAW_I) | (1UL << TEL_ALT_I) | (1UL << TEL_STATE) | (1UL << TEL_CONTROL_DT))
+
+//
+// Recorder states
+//
+enum recorderStates {
+    REC_ARMED = 0,      // Recording, waiting for a trigger
+    REC_TRIGGERED,      // Recording what follows the trigger
+    REC_HELD            // Holding the recording for a dump
+};
+
+static const char *stateNames[] = {"armed", "recording", "held"};
+static const char *triggerNames[NUM_REC_TRIGGERS] = {"state", "saturation", "deadline", "manual"};
+
+// Share of the recording from before the trigger, in %, and the enabled
+// triggers, set as parameters
+static int32_t preTrigger = 25;
+static int32_t enabledTriggers = REC_PARAM_TRIGGERS;
+
+// Record ring, in slots of recordLen bytes
+static uint8_t records[REC_BUF_SIZE];
+static uint32_t channels = REC_DEFAULT_CHANNELS;
+static uint16_t recordLen;
+static uint16_t numSlots;
+static uint16_t head;               // Next slot to write
+static uint16_t count;              // Slots filled
+static uint16_t postLeft;           // Records still to take after the trigger
+static uint16_t preCount;           // Records from before the trigger
+static volatile uint8_t state;
+static recorderTrigger_t lastTrigger;
+
+// Dump progress
+static volatile bool dumping = false;
+static uint16_t dumpIndex;
+
+static void bbCommand(char *args);
+
+//
+// Clears the recording, sizes the slots for the new channels and arms it.
+// The channels change with the recording so a sample can't be written
+// with the old slot size.
+//
+static void armRecorder(uint32_t newChannels)
+{
+    bool masked = IntMasterDisable();
+
+    channels = newChannels;
+    recordLen = REC_STAMP_LEN;
+#define REC_FIELD_SIZE(id, name, type, source) \
+    if (channels & (1UL << TEL_##id)) { \
+        recordLen += TEL_TYPE_SIZE(type); \
+    }
+    TELEMETRY_FIELDS(REC_FIELD_SIZE)
+#undef REC_FIELD_SIZE
+
+    numSlots = REC_BUF_SIZE / recordLen;
+    head = 0;
+    count = 0;
+    preCount = 0;
+    dumping = false;
+    state = REC_ARMED;
+
+    if (!masked) {
+        IntMasterEnable();
+    }
+}
+
+//
+// Initialises the recorder, its parameters and serial command, and arms it
+//
+void initRecorder(void)
+{
+    registerParam(PARAM_BB_PRE, "bb_pre", PARAM_INT, &preTrigger, 0, 100, NULL);
+    registerParam(PARAM_BB_TRIGGERS, "bb_trig", PARAM_INT, &enabledTriggers,
+                  0, REC_PARAM_TRIGGERS, NULL);
+    registerCommand("bb", bbCommand);
+    armRecorder(channels);
+}
+
+//
+// Records the chosen channels, called every control update
+//
+void recordSample(void)
+{
+    controlTiming_t timing;
+
+    if (state == REC_HELD) {
+        return;
+    }
+
+    getControlTiming(&timing);
+
+    uint8_t *next = &records[head * recordLen];
+    next = packTelemetryValue(next, TEL_U32, getTimestamp());
+
+#define REC_PACK_FIELD(id, name, type, source) \
+    if (channels & (1UL << TEL_##id)) { \
+        next = packTelemetryValue(next, type, (uint32_t)(source)); \
+    }
+    TELEMETRY_FIELDS(REC_PACK_FIELD)
+#undef REC_PACK_FIELD
+
+    head = (head + 1) % numSlots;
+    if (count < numSlots) {
+        count++;
+    }
+
+    // Holds once the share after the trigger is filled
+    if (state == REC_TRIGGERED && --postLeft == 0) {
+        state = REC_HELD;
+    }
+}
+
+//
+// Triggers the recorder if it is armed and the event is enabled
+//
+void triggerRecorder(recorderTrigger_t trigger)
+{
+    if (trigger != REC_TRIGGER_MANUAL && !(enabledTriggers & (1 << trigger))) {
+        return;
+    }
+
+    bool masked = IntMasterDisable();
+
+    if (state == REC_ARMED) {
+        uint16_t preSlots = (uint32_t)numSlots * preTrigger / 100;
+
+        // Keeps the newest preSlots records and fills the rest of the ring
+        preCount = (count < preSlots) ? count : preSlots;
+        postLeft = numSlots - preCount;
+        lastTrigger = trigger;
+        state = (postLeft == 0) ? REC_HELD : REC_TRIGGERED;
+    }
+
+    if (!masked) {
+        IntMasterEnable();
+    }
+}
+
+//
+// Kernel task, sends as many records as the transmit queue takes
+//
+void dumpRecorder(void)
+{
+    uint8_t frame[TEL_MAX_FRAME_LEN];
+
+    if (!dumping) {
+        return;
+    }
+
+    uint16_t oldest = (head + numSlots - count) % numSlots;
+    uint32_t firstStamp;
+    memcpy(&firstStamp, &records[oldest * recordLen], REC_STAMP_LEN);
+
+    while (dumpIndex < count) {
+        const uint8_t *record = &records[((oldest + dumpIndex) % numSlots) * recordLen];
+        uint32_t stamp;
+        uint8_t *next = frame;
+
+        memcpy(&stamp, record, REC_STAMP_LEN);
+        next = packTelemetryValue(next, TEL_U8, TEL_FRAME_RECORD);
+        next = packTelemetryValue(next, TEL_U16, dumpIndex);
+        next = packTelemetryValue(next, TEL_U32, ticksToMicros(stamp - firstStamp));
+        next = packTelemetryValue(next, TEL_U32, channels);
+        memcpy(next, record + REC_STAMP_LEN, recordLen - REC_STAMP_LEN);
+        next += recordLen - REC_STAMP_LEN;
+
+        if (!queueTelemetryFrame(frame, next - frame)) {
+            return;
+        }
+        dumpIndex++;
+    }
+
+    // Starts the next recording once this one is out
+    armRecorder(channels);
+}
+
+//
+// Returns true while the recording is being dumped
+//
+bool isRecorderDumping(void)
+{
+    return dumping;
+}
+
+//
+// Prints the recorder state and the recorded channels
+//
+static void sendRecorderStatus(void)
+{
+    char string[MAX_STR_LEN + 1];
+    uint8_t i;
+
+    usnprintf(string, sizeof(string), "bb %s n=%d/%d", stateNames[state], count, numSlots);
+    UARTSend(string);
+    if (state != REC_ARMED) {
+        usnprintf(string, sizeof(string), " trigger=%s at %d", triggerNames[lastTrigger], preCount);
+        UARTSend(string);
+    }
+    UARTSend("\r\nchannels:");
+    for (i = 0; i < NUM_TEL_FIELDS; i++) {
+        if (channels & (1UL << i)) {
+            UARTSend(" ");
+            UARTSend(getTelemetryChannelName(i));
+        }
+    }
+    UARTSend("\r\n");
+}
+
+//
+// Runs the recorder commands
+//
+static void bbCommand(char *args)
+{
+    if (*args == '\0') {
+        sendRecorderStatus();
+        return;
+    } else if (strcmp(args, "arm") == 0) {
+        armRecorder(channels);
+        UARTSend("bb armed\r\n");
+        return;
+    } else if (strcmp(args, "trigger") == 0) {
+        triggerRecorder(REC_TRIGGER_MANUAL);
+        sendRecorderStatus();
+        return;
+    } else if (strcmp(args, "dump") == 0) {
+        if (state != REC_HELD) {
+            UARTSend("bb not held\r\n");
+        } else {
+            // The frames start after this line
+            UARTSend("bb dump\r\n");
+            dumpIndex = 0;
+            dumping = true;
+        }
+        return;
+    }
+
+    char *onStr = strchr(args, ' ');
+    if (onStr == NULL) {
+        UARTSend("usage: bb [arm|trigger|dump|<channel> on|off]\r\n");
+        return;
+    }
+    *onStr++ = '\0';
+
+    uint8_t channel = findTelemetryChannel(args);
+    if (channel == NUM_TEL_FIELDS) {
+        UARTSend("unknown channel\r\n");
+    } else if (strcmp(onStr, "on") == 0) {
+        armRecorder(channels | (1UL << channel));
+        sendRecorderStatus();
+    } else if (strcmp(onStr, "off") == 0) {
+        armRecorder(channels & ~(1UL << channel));
+        sendRecorderStatus();
+    } else {
+        UARTSend("usage: bb <channel> on|off\r\n");
+    }
+}
@@ -0,0 +1,58 @@
+//*****************************************************************************
+//
+// recorder.h - Black box flight recorder.  Records a chosen set of the
+// telemetry channels every control update into a RAM ring, keeps a set
+// share of it from before a trigger (a state change, the main rotor
+// saturating or a missed control deadline) and fills the rest after it,
+// then holds the recording until it is dumped over serial, and re-arms.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#ifndef RECORDER_H_
+#define RECORDER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//
+// Events that can trigger the recorder, also the bits of the bb_trig
+// parameter
+//
+enum recorderTriggers {
+    REC_TRIGGER_STATE = 0,      // Heli state changed
+    REC_TRIGGER_SATURATION,     // Main rotor hit a duty limit
+    REC_TRIGGER_DEADLINE,       // Control update came too late
+    REC_TRIGGER_MANUAL,         // "bb trigger" command
+    NUM_REC_TRIGGERS
+};
+typedef enum recorderTriggers recorderTrigger_t;
+
+//
+// Initialises the recorder, its parameters and serial command, and arms it
+//
+void initRecorder(void);
+
+//
+// Records the chosen channels, called every control update
+//
+void recordSample(void);
+
+//
+// Triggers the recorder if it is armed and the event is enabled
+//
+void triggerRecorder(recorderTrigger_t trigger);
+
+//
+// Kernel task, sends the recording while a dump is running, then re-arms
+//
+void dumpRecorder(void);
+
+//
+// Returns true while the recording is being dumped
+//
+bool isRecorderDumping(void);
+
+#endif /*RECORDER_H_*/
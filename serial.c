@@ -1,9 +1,18 @@
 //*****************************************************************************
 //
-// serial.c - Module for sending serial communication through the USB
+// serial.c - Module for serial communication through the USB.  Sends the
+// heli info and receives line based commands, which are run by the
+// commands registered with registerCommand().  Transmitting only queues
+// the data, the UART interrupt drains the queue into the TX FIFO.
+//
+// The status line is formatted in one pass straight into the transmit
+// queue, and only queued once it is whole.
+//
+// Serial commands:
+//   fmtbench   - times the status line formatter against usnprintf
 //
 // Author:  bma206, tki36
-// Last modified:   21.5.2024
+// Last modified:   19.10.2026
 //
 //*****************************************************************************
 // Based on week 4 lab uartDemo.c 
@@ -23,12 +32,16 @@
 #include "utils/ustdlib.h"
 #include "stdio.h"
 #include "stdlib.h"
+#include "string.h"
 #include "control.h"
+#include "serial.h"
 
 #include "yaw.h"
 #include "altitude.h"
 #include "pwm.h"
-#include "switch.h"
+#include "flight.h"
+#include "params.h"
+#include "timer.h"
 
 
 
@@ -37,6 +50,8 @@
 #define MAX_STR_LEN 35
 //---USB Serial comms: UART0, Rx:PA0 , Tx:PA1
 #define BAUD_RATE 9600
+#define MAX_BAUD_RATE 921600
+#define UART_CONFIG (UART_CONFIG_WLEN_8 | UART_CONFIG_STOP_ONE | UART_CONFIG_PAR_NONE)
 #define UART_USB_BASE           UART0_BASE
 #define UART_USB_PERIPH_UART    SYSCTL_PERIPH_UART0
 #define UART_USB_PERIPH_GPIO    SYSCTL_PERIPH_GPIOA
@@ -46,9 +61,107 @@
 #define UART_USB_GPIO_PINS      UART_USB_GPIO_PIN_RX | UART_USB_GPIO_PIN_TX
 
 
+// Max command line length and number of commands
+#define MAX_LINE_LEN 40
+#define MAX_COMMANDS 16
+
+// Transmit queue size, a power of two
+#define TX_BUF_SIZE 2048
+
 int16_t alt;
 
+static void fmtbenchCommand(char *args);
+
+// Registered serial commands
+static serialCommand_t commands[MAX_COMMANDS];
+static uint8_t numCommands = 0;
+
+// Line being received, and the last complete line waiting to be run
+static char rxLine[MAX_LINE_LEN + 1];
+static uint8_t rxLineLen = 0;
+static char commandLine[MAX_LINE_LEN + 1];
+static volatile bool commandReady = false;
+
+// Transmit queue, filled by UARTWrite and drained by the interrupt
+static char txBuf[TX_BUF_SIZE];
+static volatile uint16_t txHead = 0;    // Next free slot
+static volatile uint16_t txTail = 0;    // Next byte to send
+static volatile uint32_t txDropped = 0;
+
+// Line being built straight into the transmit queue, from txHead
+static uint16_t txLineHead;
+static uint16_t txLineLen;
+static bool txLineFull;
+
+// Status lines built per run of the format benchmark
+#define FMT_BENCH_RUNS 32
+
+// Baud rate, set as a parameter
+static int32_t baudRate = BAUD_RATE;
+
+//
+// Moves queued bytes into the TX FIFO until either is full or empty
+//
+static void fillTxFIFO(void)
+{
+    while (txTail != txHead && UARTSpaceAvail(UART_USB_BASE)) {
+        UARTCharPutNonBlocking(UART_USB_BASE, txBuf[txTail]);
+        txTail = (txTail + 1) & (TX_BUF_SIZE - 1);
+    }
+}
 
+//
+// Starts sending newly queued bytes.  The TX interrupt only fires as the
+// FIFO drains, so this starts it off if it is idle.
+//
+static void startTx(void)
+{
+    UARTIntDisable(UART_USB_BASE, UART_INT_TX);
+    fillTxFIFO();
+    UARTIntEnable(UART_USB_BASE, UART_INT_TX);
+}
+
+//
+// The interrupt handler for the UART FIFOs.  Refills the TX FIFO from the
+// queue, and collects received characters into a line and hands complete
+// lines to processSerialCommands().
+//
+void UARTIntHandler(void)
+{
+    uint32_t status = UARTIntStatus(UART_USB_BASE, true);
+    UARTIntClear(UART_USB_BASE, status);
+
+    if (status & UART_INT_TX) {
+        fillTxFIFO();
+    }
+
+    while (UARTCharsAvail(UART_USB_BASE)) {
+        char c = (char)UARTCharGetNonBlocking(UART_USB_BASE);
+
+        if (c == '\r' || c == '\n') {
+            // Drops the line if the last one hasn't been run yet
+            if (rxLineLen > 0 && !commandReady) {
+                rxLine[rxLineLen] = '\0';
+                memcpy(commandLine, rxLine, rxLineLen + 1);
+                commandReady = true;
+            }
+            rxLineLen = 0;
+        } else if (rxLineLen < MAX_LINE_LEN) {
+            rxLine[rxLineLen++] = c;
+        }
+    }
+}
+
+
+
+//
+// Reconfigures the UART for the baud rate parameter.  Waits for the
+// character being sent to finish.
+//
+static void applyBaudRate(void)
+{
+    UARTConfigSetExpClk(UART_USB_BASE, SysCtlClockGet(), baudRate, UART_CONFIG);
+}
 
 //
 // Initialises the serial communation
@@ -61,82 +174,331 @@ void initUART (void)
     SysCtlPeripheralEnable (SYSCTL_PERIPH_GPIOA);
     // Select the alternate (UART) function for these pins.
     GPIOPinTypeUART (GPIO_PORTA_BASE, GPIO_PIN_0 | GPIO_PIN_1);
-    UARTConfigSetExpClk (UART0_BASE, SysCtlClockGet(), BAUD_RATE,
-    UART_CONFIG_WLEN_8 | UART_CONFIG_STOP_ONE | 
-    UART_CONFIG_PAR_NONE);
+    UARTConfigSetExpClk (UART0_BASE, SysCtlClockGet(), baudRate, UART_CONFIG);
     UARTFIFOEnable (UART0_BASE);
     UARTEnable (UART0_BASE);
+
+    // Transmit interrupt when the FIFO drains to 1/8, receive interrupts on
+    // FIFO level and on receive timeout
+    UARTFIFOLevelSet(UART_USB_BASE, UART_FIFO_TX1_8, UART_FIFO_RX4_8);
+    UARTTxIntModeSet(UART_USB_BASE, UART_TXINT_MODE_FIFO);
+    UARTIntRegister(UART_USB_BASE, UARTIntHandler);
+    UARTIntEnable(UART_USB_BASE, UART_INT_TX | UART_INT_RX | UART_INT_RT);
+
+    registerParam(PARAM_BAUD_RATE, "baud", PARAM_INT, &baudRate, BAUD_RATE, MAX_BAUD_RATE,
+                  applyBaudRate);
+    registerCommand("fmtbench", fmtbenchCommand);
 }
 
-//**********************************************************************
-// Transmit a string via UART0
-//**********************************************************************
-void UARTSend (char *pucBuffer)
+//
+// Registers a serial command, the handler gets the rest of the line
+//
+void registerCommand(const char *name, void (*handler)(char *args))
 {
-    // Loop while there are more characters to send.
-    while(*pucBuffer)
-    {
-        // Write the next character to the UART Tx FIFO.
-        UARTCharPut(UART0_BASE, *pucBuffer);
-        pucBuffer ++;
+    if (numCommands < MAX_COMMANDS) {
+        serialCommand_t new_command = {name, handler};
+        commands[numCommands] = new_command;
+        numCommands++;
     }
 }
 
 //
-// Gets the info of the heli and sends it through the usb
+// Runs the last received command line, if there is one
 //
-void UARTSendData(void)
+void processSerialCommands(void)
 {
-    char string[MAX_STR_LEN + 1];
+    uint8_t i;
+
+    if (!commandReady) {
+        return;
+    }
+
+    // Splits the command name from its arguments
+    char *args = strchr(commandLine, ' ');
+    if (args != NULL) {
+        *args++ = '\0';
+    } else {
+        args = commandLine + strlen(commandLine);
+    }
+
+    for (i = 0; i < numCommands; i++) {
+        if (strcmp(commands[i].name, commandLine) == 0) {
+            commands[i].handler(args);
+            break;
+        }
+    }
+    if (i == numCommands) {
+        UARTSend("unknown command\r\n");
+    }
+
+    commandReady = false;
+}
 
-    int16_t altADC = getAltitudeADC();
+//
+// Queues bytes to transmit without blocking, returns the number queued.
+// Data is queued whole or not at all, so a full queue never truncates a
+// line.  Bytes that don't fit are dropped and counted.
+//
+uint16_t UARTWrite(const char *data, uint16_t len)
+{
+    uint16_t head = txHead;
+    uint16_t space = (txTail - head - 1) & (TX_BUF_SIZE - 1);
+    uint16_t i;
 
-    getAltitudePercentage(altADC, &alt);
+    if (len > space) {
+        txDropped += len;
+        return 0;
+    }
+
+    for (i = 0; i < len; i++) {
+        txBuf[head] = data[i];
+        head = (head + 1) & (TX_BUF_SIZE - 1);
+    }
+    txHead = head;
+    startTx();
+
+    return len;
+}
+
+//
+// Gets the number of bytes that can be queued without dropping any
+//
+uint16_t getUARTFree(void)
+{
+    return (txTail - txHead - 1) & (TX_BUF_SIZE - 1);
+}
+
+//
+// Queues a string to transmit via UART0, whole or not at all
+//
+void UARTSend (const char *pucBuffer)
+{
+    UARTWrite(pucBuffer, strlen(pucBuffer));
+}
+
+//
+// Gets the number of bytes dropped because the transmit queue was full
+//
+uint32_t getUARTDropped(void)
+{
+    return txDropped;
+}
+
+//
+// Starts building a line straight into the transmit queue
+//
+static void beginTxLine(void)
+{
+    txLineHead = txHead;
+    txLineLen = 0;
+    txLineFull = false;
+}
+
+//
+// Adds a character to the line being built
+//
+static void putTxChar(char c)
+{
+    uint16_t next = (txLineHead + 1) & (TX_BUF_SIZE - 1);
 
-    // Sends The Info through the serial
+    txLineLen++;
+    if (txLineFull || next == txTail) {
+        txLineFull = true;
+        return;
+    }
+    txBuf[txLineHead] = c;
+    txLineHead = next;
+}
+
+//
+// Adds a string to the line being built
+//
+static void putTxString(const char *str)
+{
+    while (*str != '\0') {
+        putTxChar(*str++);
+    }
+}
+
+//
+// Adds a number right aligned in width characters, like "%*d"
+//
+static void putTxNumber(uint32_t magnitude, bool negative, uint8_t width)
+{
+    char digits[10];
+    uint8_t len = 0;
+
+    do {
+        digits[len++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude != 0);
+
+    uint8_t used = len + negative;
+    while (used++ < width) {
+        putTxChar(' ');
+    }
+    if (negative) {
+        putTxChar('-');
+    }
+    while (len > 0) {
+        putTxChar(digits[--len]);
+    }
+}
+
+//
+// Adds an integer right aligned in width characters
+//
+static void putTxInt(int32_t value, uint8_t width)
+{
+    putTxNumber(value < 0 ? -(uint32_t)value : (uint32_t)value, value < 0, width);
+}
+
+//
+// Adds a value in tenths as "<whole>.<tenth>", the whole part right
+// aligned in width characters
+//
+static void putTxTenths(int32_t tenths, uint8_t width)
+{
+    uint32_t magnitude = tenths < 0 ? -(uint32_t)tenths : (uint32_t)tenths;
+
+    putTxNumber(magnitude / 10, tenths < 0, width);
+    putTxChar('.');
+    putTxChar('0' + magnitude % 10);
+}
+
+//
+// Queues the line built, or drops all of it if it didn't fit with room
+// left for command replies
+//
+static void commitTxLine(void)
+{
+    if (txLineFull || ((txTail - txLineHead - 1) & (TX_BUF_SIZE - 1)) < TX_REPLY_RESERVE) {
+        txDropped += txLineLen;
+        return;
+    }
+    txHead = txLineHead;
+    startTx();
+}
+
+//
+// Builds the status line, reading each value once
+//
+static void buildDataLine(void)
+{
+    controlTiming_t timing;
+    int16_t targetYaw = getTargetYaw();
+    int16_t currentYaw = getCurrentYaw();
+
+    getAltitudePercentage(getAltitudeADC(), &alt);
+    getControlTiming(&timing);
+
+    beginTxLine();
+    putTxString("yaw_d=");
+    putTxTenths(targetYaw, 3);
+    putTxString(" |yaw=");
+    putTxTenths(currentYaw, 3);
+    putTxString(" |alt_d=");
+    putTxInt(getTargetAltitude(), 3);
+    putTxString(" |alt=");
+    putTxInt(alt, 3);
+    putTxString(" |state=");
+    putTxString(getHeliStateName(getHeliState()));
+    putTxString(" |tailPWM=");
+    putTxInt(getTailPower(), 3);
+    putTxString(" |mainPWM=");
+    putTxInt(getMainPower(), 3);
+    putTxString(" |yawER=");
+    putTxInt(getYawError(), 3);
+    putTxString(" |yawDI=");
+    putTxInt(getYI(), 3);
+
+    // Control interval and its recent jitter, in us
+    putTxString(" |dt=");
+    putTxInt(timing.lastUs, 5);
+    putTxString(" jit=");
+    putTxInt(timing.jitterUs, 5);
+
+    // Bytes lost to a full transmit queue
+    putTxString(" |drop=");
+    putTxInt(getUARTDropped(), 0);
+    putTxString(" |\n");
+}
+
+//
+// Builds the status line the old way, with usnprintf for each field, for
+// the benchmark
+//
+static void buildDataLineUsnprintf(void)
+{
+    char string[MAX_STR_LEN + 1];
+    controlTiming_t timing;
+
+    getAltitudePercentage(getAltitudeADC(), &alt);
+
+    beginTxLine();
     usnprintf(string, sizeof(string), "yaw_d=%3d.%d |", getTargetYaw()/10, abs(getTargetYaw()%10));
-    UARTSend(string);
+    putTxString(string);
     usnprintf(string, sizeof(string), "yaw=%3d.%d |", getCurrentYaw()/10, abs(getCurrentYaw()%10));
-    UARTSend(string);
+    putTxString(string);
     usnprintf(string, sizeof(string), "alt_d=%3d |", getTargetAltitude());
-    UARTSend(string);
+    putTxString(string);
     usnprintf(string, sizeof(string), "alt=%3d |", alt);
-    UARTSend(string);
-    // Gets the heli state and converts it to string
-    switch(getHeliState()) {
-        case LANDED:
-            usnprintf(string, sizeof(string), "state=LANDED |");
-            break;
-        case FIND_YAW:
-            usnprintf(string, sizeof(string), "state=FIND_YAW |");
-            break;
-        case FLYING:
-            usnprintf(string, sizeof(string), "state=FLYING |");
-            break;
-        case RESET_YAW:
-            usnprintf(string, sizeof(string), "state=RESET_YAW |");
-            break;
-        case LANDING:
-            usnprintf(string, sizeof(string), "state=LANDING |");
-            break;
-    }
-    UARTSend(string);
-
+    putTxString(string);
+    usnprintf(string, sizeof(string), "state=%s |", getHeliStateName(getHeliState()));
+    putTxString(string);
     usnprintf(string, sizeof(string), "tailPWM=%3d |", getTailPower());
-    UARTSend(string);
-
+    putTxString(string);
     usnprintf(string, sizeof(string), "mainPWM=%3d |", getMainPower());
-    UARTSend(string);
-
+    putTxString(string);
     usnprintf(string, sizeof(string), "yawER=%3d |", getYawError());
-    UARTSend(string);
+    putTxString(string);
+    usnprintf(string, sizeof(string), "yawDI=%3d |", getYI());
+    putTxString(string);
+    getControlTiming(&timing);
+    usnprintf(string, sizeof(string), "dt=%5d jit=%5d |", timing.lastUs, timing.jitterUs);
+    putTxString(string);
+    usnprintf(string, sizeof(string), "drop=%d |", getUARTDropped());
+    putTxString(string);
+    usnprintf(string, sizeof(string), "\n");
+    putTxString(string);
+}
 
-    usnprintf(string, sizeof(string), "yawDI=%3d |", (int32_t)getYI());
-    UARTSend(string);
+//
+// Gets the info of the heli and sends it through the usb
+//
+void UARTSendData(void)
+{
+    buildDataLine();
+    commitTxLine();
+}
 
+//
+// Times building the status line with the formatter and with usnprintf,
+// in CPU cycles.  The lines are built in the transmit queue but not sent.
+//
+static void fmtbenchCommand(char *args)
+{
+    char string[MAX_STR_LEN + 1];
+    uint32_t start;
+    uint32_t formatterTicks;
+    uint32_t usnprintfTicks;
+    uint8_t i;
 
+    start = getTimestamp();
+    for (i = 0; i < FMT_BENCH_RUNS; i++) {
+        buildDataLine();
+    }
+    formatterTicks = getTimestamp() - start;
 
+    start = getTimestamp();
+    for (i = 0; i < FMT_BENCH_RUNS; i++) {
+        buildDataLineUsnprintf();
+    }
+    usnprintfTicks = getTimestamp() - start;
 
-    usnprintf(string, sizeof(string), "\n");
+    // Timer ticks are CPU cycles
+    usnprintf(string, sizeof(string), "formatter=%d cycles\r\n", formatterTicks / FMT_BENCH_RUNS);
+    UARTSend(string);
+    usnprintf(string, sizeof(string), "usnprintf=%d cycles\r\n", usnprintfTicks / FMT_BENCH_RUNS);
     UARTSend(string);
 }
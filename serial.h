@@ -1,9 +1,9 @@
 //*****************************************************************************
 //
-// serial.h - Header module for sending serial communication through the USB
+// serial.h - Header module for serial communication through the USB
 //
 // Author:  bma206, tki36
-// Last modified:   21.5.2024
+// Last modified:   19.10.2026
 //
 //*****************************************************************************
 
@@ -11,6 +11,20 @@
 #ifndef SERIAL_H
 #define SERIAL_H
 
+#include <stdint.h>
+
+// Transmit queue space periodic output (the status line and telemetry)
+// leaves free, so command replies still fit while it keeps the link busy
+#define TX_REPLY_RESERVE 256
+
+//
+// A command that can be run over serial
+//
+typedef struct {
+    const char *name;
+    void (*handler)(char *args);
+} serialCommand_t;
+
 //
 // Initialises the serial communation
 //
@@ -21,4 +35,37 @@ void initUART (void);
 //
 void UARTSendData(void);
 
+//
+// Queues bytes to transmit without blocking, returns the number queued.
+// Data is queued whole or not at all, so a full queue never truncates a
+// line.  Bytes that don't fit are dropped and counted.
+//
+uint16_t UARTWrite(const char *data, uint16_t len);
+
+//
+// Gets the number of bytes that can be queued without dropping any
+//
+uint16_t getUARTFree(void);
+
+//
+// Queues a string to transmit via UART0, without blocking.  A string that
+// doesn't fit is dropped whole.
+//
+void UARTSend (const char *pucBuffer);
+
+//
+// Gets the number of bytes dropped because the transmit queue was full
+//
+uint32_t getUARTDropped(void);
+
+//
+// Registers a serial command, the handler gets the rest of the line
+//
+void registerCommand(const char *name, void (*handler)(char *args));
+
+//
+// Runs the last received command line, if there is one
+//
+void processSerialCommands(void);
+
 #endif // SERIAL_H
@@ -0,0 +1,135 @@
+//*****************************************************************************
+//
+// shaper.c - Actuator output shaping.  Limits how fast a rotor's duty can
+// change (slew) and how fast that rate can change (acceleration).  The
+// controller is given the allowed range as its output limits, so its
+// anti-windup sees the shaping instead of winding up against it.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "shaper.h"
+
+//
+// Initialises a shaper with the given limits and a cleared state
+//
+void initShaper(shaper_t *shaper, pidNum_t maxSlew, pidNum_t maxAccel)
+{
+    setShaperLimits(shaper, maxSlew, maxAccel);
+    resetShaper(shaper);
+    resetShaperStats(shaper);
+}
+
+//
+// Sets the slew and acceleration limits
+//
+void setShaperLimits(shaper_t *shaper, pidNum_t maxSlew, pidNum_t maxAccel)
+{
+    shaper->maxSlew = maxSlew;
+    shaper->maxAccel = maxAccel;
+}
+
+//
+// Clears the state
+//
+void resetShaper(shaper_t *shaper)
+{
+    shaper->value = 0;
+    shaper->rate = 0;
+    shaper->primed = false;
+    shaper->minShaped = false;
+    shaper->maxShaped = false;
+    shaper->shapedMin = 0;
+    shaper->shapedMax = 0;
+}
+
+//
+// Clears the statistics
+//
+void resetShaperStats(shaper_t *shaper)
+{
+    shaper->updates = 0;
+    shaper->limited = 0;
+}
+
+//
+// Narrows the output range to what the shaper allows over the next dt
+//
+void limitShaperRange(shaper_t *shaper, pidNum_t dt, pidNum_t *min, pidNum_t *max)
+{
+    shaper->minShaped = false;
+    shaper->maxShaped = false;
+
+    if (!shaper->primed || dt <= 0) {
+        return;
+    }
+
+    // Allowed rates, from the acceleration limit around the current rate
+    // and then the slew limit
+    pidNum_t minRate = 0;
+    pidNum_t maxRate = 0;
+    bool rateLimited = false;
+
+    if (shaper->maxAccel > 0) {
+        pidNum_t step = PID_MUL(shaper->maxAccel, dt);
+        minRate = shaper->rate - step;
+        maxRate = shaper->rate + step;
+        rateLimited = true;
+    }
+    if (shaper->maxSlew > 0) {
+        if (!rateLimited || minRate < -shaper->maxSlew) {
+            minRate = -shaper->maxSlew;
+        }
+        if (!rateLimited || maxRate > shaper->maxSlew) {
+            maxRate = shaper->maxSlew;
+        }
+        rateLimited = true;
+    }
+    if (!rateLimited) {
+        return;
+    }
+
+    // The given range wins where they don't overlap
+    pidNum_t low = shaper->value + PID_MUL(minRate, dt);
+    pidNum_t high = shaper->value + PID_MUL(maxRate, dt);
+
+    if (low > *min) {
+        *min = (low < *max) ? low : *max;
+        shaper->minShaped = true;
+        shaper->shapedMin = *min;
+    }
+    if (high < *max) {
+        *max = (high > *min) ? high : *min;
+        shaper->maxShaped = true;
+        shaper->shapedMax = *max;
+    }
+}
+
+//
+// Records the output actually applied
+//
+void updateShaper(shaper_t *shaper, pidNum_t value, pidNum_t dt)
+{
+    if (shaper->primed && dt > 0) {
+        shaper->rate = PID_DIV(value - shaper->value, dt);
+    } else {
+        shaper->rate = 0;
+    }
+
+    // Counts outputs held back by the shaper rather than the given range
+    shaper->updates++;
+    if ((shaper->minShaped && value <= shaper->shapedMin)
+            || (shaper->maxShaped && value >= shaper->shapedMax)) {
+        shaper->limited++;
+    }
+    shaper->minShaped = false;
+    shaper->maxShaped = false;
+
+    shaper->value = value;
+    shaper->primed = true;
+}
@@ -0,0 +1,74 @@
+//*****************************************************************************
+//
+// shaper.h - Actuator output shaping.  Limits how fast a rotor's duty can
+// change (slew) and how fast that rate can change (acceleration).  The
+// controller is given the allowed range as its output limits, so its
+// anti-windup sees the shaping instead of winding up against it.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#ifndef SHAPER_H_
+#define SHAPER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pid.h"
+
+//
+// Shaper limits and state
+//
+typedef struct {
+    // Limits, 0 is no limit
+    pidNum_t maxSlew;       // Units per second
+    pidNum_t maxAccel;      // Units per second squared
+
+    // State
+    pidNum_t value;         // Last applied output
+    pidNum_t rate;          // Rate of the last applied output
+    bool primed;            // Set once value is valid
+    bool minShaped;         // Range handed out was raised by the shaper
+    bool maxShaped;         // Range handed out was lowered by the shaper
+    pidNum_t shapedMin;
+    pidNum_t shapedMax;
+
+    // Statistics
+    uint32_t updates;
+    uint32_t limited;       // Updates where the output sat on a shaped limit
+} shaper_t;
+
+//
+// Initialises a shaper with the given limits and a cleared state
+//
+void initShaper(shaper_t *shaper, pidNum_t maxSlew, pidNum_t maxAccel);
+
+//
+// Sets the slew and acceleration limits, 0 for no limit
+//
+void setShaperLimits(shaper_t *shaper, pidNum_t maxSlew, pidNum_t maxAccel);
+
+//
+// Clears the state, so the next output isn't limited
+//
+void resetShaper(shaper_t *shaper);
+
+//
+// Clears the statistics
+//
+void resetShaperStats(shaper_t *shaper);
+
+//
+// Narrows the output range min..max to what the shaper allows over the
+// next dt.  The given range wins if they don't overlap.
+//
+void limitShaperRange(shaper_t *shaper, pidNum_t dt, pidNum_t *min, pidNum_t *max);
+
+//
+// Records the output applied dt after the last one, counting it as
+// limited if it sits on a bound the shaper set
+//
+void updateShaper(shaper_t *shaper, pidNum_t value, pidNum_t dt);
+
+#endif /*SHAPER_H_*/
@@ -6,7 +6,7 @@
 // switch.h - Module to use the switch 1
 //
 // Author:  bma206, tki36
-// Last modified:   9.5.2024
+// Last modified:   19.10.2026
 //
 //*****************************************************************************
 
@@ -19,35 +19,17 @@
 #include "driverlib/debug.h"
 
 //
-// Type to keep track of state of switch
+// Switch ports and pins, up is high
 //
-enum swStates {SW_DOWN = 0, SW_UP, SW_NO_CHANGE};
-typedef enum swStates swState_t;
+#define SW1_PERIPH      SYSCTL_PERIPH_GPIOA
+#define SW1_PORT_BASE   GPIO_PORTA_BASE
+#define SW1_PIN         GPIO_PIN_7
+#define SW1_NORMAL      false
 
 //
-// Type to track what the helicopter is currently doing
-//
-enum heliStates {LANDED = 0, FIND_YAW, FLYING, RESET_YAW, LANDING};
-typedef enum heliStates heliState_t;
-
-//
-// Initialises the switch with its initial state
+// Initialises the switch pin.  The switch is read through the input
+// module, which debounces it.
 //
 void initSwitch(void);
 
-//
-// Updates the switch and returns its current state
-//
-swState_t updateSwitch(void);
-
-//
-// Set the state of the helicopter
-//
-void setHeliState(heliState_t state);
-
-//
-// Get the state of the helicopter
-//
-heliState_t getHeliState(void);
-
 #endif /*SWITCH_H_*/
@@ -0,0 +1,350 @@
+//*****************************************************************************
+//
+// telemetry.c - Sends the heli's state over serial at a set rate, either
+// as the text status line or as binary frames laid out by
+// telemetryFields.h.  Binary frames are only queued whole, so a full
+// transmit queue skips a frame rather than corrupting one.
+//
+// Each field of the table is a channel, sent every divider'th telemetry
+// tick or not at all.  A frame carries only the channels that are due,
+// and as many of them as fit in the transmit queue.  The rest wait for
+// the next frame, which starts from the first one left out.
+//
+// Serial commands:
+//   tel                    - prints the channels and their rates
+//   tel <name> <divider>   - sends a channel every divider ticks, 0 is off
+//   tel all <divider>      - the same for every channel
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "utils/ustdlib.h"
+
+#include "altitude.h"
+#include "yaw.h"
+#include "pwm.h"
+#include "flight.h"
+#include "control.h"
+#include "serial.h"
+#include "timer.h"
+#include "kernel.h"
+#include "params.h"
+#include "crc16.h"
+#include "cobs.h"
+#include "recorder.h"
+#include "telemetryFields.h"
+#include "telemetry.h"
+
+// Telemetry formats
+enum telModes {TEL_MODE_TEXT = 0, TEL_MODE_BINARY};
+
+// Format and rate, set as parameters.  At 9600 baud the link carries
+// about 960 bytes/s and a text line is about 135 bytes, so the default
+// rate leaves room for command replies.
+static int32_t telMode = TEL_MODE_TEXT;
+static int32_t telRate = 5;            // Hz
+#define MAX_TEL_RATE 1000
+#define MAX_TEL_DIVIDER 1000
+
+#define MAX_STR_LEN 40
+
+// Channel names, from the field table
+#define TEL_FIELD_NAME(id, name, type, source) name,
+static const char *channelNames[NUM_TEL_FIELDS] = {
+    TELEMETRY_FIELDS(TEL_FIELD_NAME)
+};
+#undef TEL_FIELD_NAME
+
+#define TEL_FIELD_TYPE(id, name, type, source) type,
+static const telType_t channelTypes[NUM_TEL_FIELDS] = {
+    TELEMETRY_FIELDS(TEL_FIELD_TYPE)
+};
+#undef TEL_FIELD_TYPE
+
+// Ticks between sends of each channel, 0 is off
+static uint16_t channelDivider[NUM_TEL_FIELDS];
+
+// Channels due but not sent yet, and where the next frame starts filling
+static uint32_t pendingChannels = 0;
+static uint8_t firstChannel = 0;
+static uint32_t tick = 0;
+
+// Time the last telemetry was sent, and the running frame time
+static uint32_t lastSendTime;
+static uint64_t elapsedTicks = 0;
+static uint16_t sequence = 0;
+static uint32_t skipped = 0;
+
+//
+// Puts a value in a frame, little-endian, and returns the next byte
+//
+uint8_t *packTelemetryValue(uint8_t *frame, telType_t type, uint32_t value)
+{
+    uint8_t size = TEL_TYPE_SIZE(type);
+    uint8_t i;
+
+    for (i = 0; i < size; i++) {
+        *frame++ = value >> (8 * i);
+    }
+    return frame;
+}
+
+//
+// Adds the CRC to a frame, encodes it and queues it whole.  Returns false
+// if there wasn't room for it with room left for command replies.
+//
+bool queueTelemetryFrame(uint8_t *frame, uint16_t len)
+{
+    uint8_t encoded[COBS_MAX_LEN(TEL_MAX_FRAME_LEN) + 1];
+
+    packTelemetryValue(frame + len, TEL_U16, getCRC16(frame, len));
+    len = encodeCOBS(frame, len + TEL_CRC_LEN, encoded);
+    encoded[len++] = 0;
+
+    if (getUARTFree() < len + TX_REPLY_RESERVE) {
+        return false;
+    }
+    UARTWrite((const char *)encoded, len);
+    return true;
+}
+
+//
+// Picks the pending channels that fit in the transmit queue, starting
+// from the first one left out of the last frame
+//
+static uint32_t selectChannels(void)
+{
+    uint16_t free = getUARTFree();
+    free = (free > TX_REPLY_RESERVE) ? free - TX_REPLY_RESERVE : 0;
+    uint16_t len = TEL_HEADER_LEN + TEL_MASK_LEN + TEL_CRC_LEN;
+    uint32_t mask = 0;
+    uint8_t start = firstChannel;
+    bool leftOut = false;
+    uint8_t i;
+
+    for (i = 0; i < NUM_TEL_FIELDS; i++) {
+        uint8_t channel = (start + i) % NUM_TEL_FIELDS;
+        uint8_t size = TEL_TYPE_SIZE(channelTypes[channel]);
+
+        if (!(pendingChannels & (1UL << channel))) {
+            continue;
+        }
+        if (COBS_MAX_LEN(len + size) + 1 > free) {
+            if (!leftOut) {
+                firstChannel = channel;
+                leftOut = true;
+            }
+            continue;
+        }
+        mask |= 1UL << channel;
+        len += size;
+    }
+    return mask;
+}
+
+//
+// Builds and queues a binary frame of the due channels
+//
+static void sendTelemetryFrame(uint32_t timeUs)
+{
+    uint8_t frame[TEL_MAX_FRAME_LEN];
+    uint8_t *next = frame;
+    controlTiming_t timing;
+
+    // Skips the frame if not even one channel fits
+    uint32_t mask = selectChannels();
+    if (mask == 0) {
+        skipped++;
+        return;
+    }
+
+    getControlTiming(&timing);
+
+    // A frame of every channel doesn't need the mask
+    if (mask == TEL_ALL_FIELDS) {
+        next = packTelemetryValue(next, TEL_U8, TEL_FRAME_FULL);
+    } else {
+        next = packTelemetryValue(next, TEL_U8, TEL_FRAME_MASKED);
+    }
+    next = packTelemetryValue(next, TEL_U16, sequence);
+    next = packTelemetryValue(next, TEL_U32, timeUs);
+    if (mask != TEL_ALL_FIELDS) {
+        next = packTelemetryValue(next, TEL_U32, mask);
+    }
+
+#define TEL_PACK_FIELD(id, name, type, source) \
+    if (mask & (1UL << TEL_##id)) { \
+        next = packTelemetryValue(next, type, (uint32_t)(source)); \
+    }
+    TELEMETRY_FIELDS(TEL_PACK_FIELD)
+#undef TEL_PACK_FIELD
+
+    queueTelemetryFrame(frame, next - frame);
+    pendingChannels &= ~mask;
+    sequence++;
+}
+
+//
+// Adds the channels due this tick to the pending ones
+//
+static void scheduleChannels(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < NUM_TEL_FIELDS; i++) {
+        if (channelDivider[i] != 0 && tick % channelDivider[i] == 0) {
+            pendingChannels |= 1UL << i;
+        }
+    }
+    tick++;
+}
+
+//
+// Finds a channel by name, NUM_TEL_FIELDS if there isn't one
+//
+uint8_t findTelemetryChannel(const char *name)
+{
+    uint8_t i;
+
+    for (i = 0; i < NUM_TEL_FIELDS; i++) {
+        if (strcmp(channelNames[i], name) == 0) {
+            break;
+        }
+    }
+    return i;
+}
+
+//
+// Gets the name of a channel
+//
+const char *getTelemetryChannelName(uint8_t channel)
+{
+    return channelNames[channel];
+}
+
+//
+// Prints a channel and its rate
+//
+static void sendChannel(uint8_t channel)
+{
+    char string[MAX_STR_LEN + 1];
+
+    if (channelDivider[channel] == 0) {
+        usnprintf(string, sizeof(string), "%s off\r\n", channelNames[channel]);
+    } else {
+        usnprintf(string, sizeof(string), "%s div=%d %d Hz\r\n", channelNames[channel],
+                  channelDivider[channel], telRate / channelDivider[channel]);
+    }
+    UARTSend(string);
+}
+
+//
+// Prints the channels, or sets their dividers with "<name|all> <divider>"
+//
+static void telCommand(char *args)
+{
+    const char *end;
+    uint8_t i;
+
+    if (*args == '\0') {
+        for (i = 0; i < NUM_TEL_FIELDS; i++) {
+            sendChannel(i);
+        }
+        return;
+    }
+
+    char *dividerStr = strchr(args, ' ');
+    if (dividerStr == NULL) {
+        UARTSend("usage: tel <name|all> <divider>\r\n");
+        return;
+    }
+    *dividerStr++ = '\0';
+
+    uint32_t divider = ustrtoul(dividerStr, &end, 10);
+    if (end == dividerStr || *end != '\0' || divider > MAX_TEL_DIVIDER) {
+        UARTSend("bad divider\r\n");
+        return;
+    }
+
+    if (strcmp(args, "all") == 0) {
+        for (i = 0; i < NUM_TEL_FIELDS; i++) {
+            channelDivider[i] = divider;
+        }
+        pendingChannels = 0;
+        UARTSend("ok\r\n");
+        return;
+    }
+
+    uint8_t channel = findTelemetryChannel(args);
+    if (channel == NUM_TEL_FIELDS) {
+        UARTSend("unknown channel\r\n");
+        return;
+    }
+    channelDivider[channel] = divider;
+    if (divider == 0) {
+        pendingChannels &= ~(1UL << channel);
+    }
+    sendChannel(channel);
+}
+
+//
+// Initialises telemetry and its parameters
+//
+void initTelemetry(void)
+{
+    uint8_t i;
+
+    lastSendTime = getTimestamp();
+
+    // Every channel at the telemetry rate
+    for (i = 0; i < NUM_TEL_FIELDS; i++) {
+        channelDivider[i] = 1;
+    }
+    registerCommand("tel", telCommand);
+
+    registerParam(PARAM_TEL_MODE, "tel_mode", PARAM_INT, &telMode,
+                  TEL_MODE_TEXT, TEL_MODE_BINARY, NULL);
+    registerParam(PARAM_TEL_RATE, "tel_rate", PARAM_INT, &telRate, 1, MAX_TEL_RATE, NULL);
+}
+
+//
+// Kernel task, sends telemetry when it is due
+//
+void sendTelemetry(void)
+{
+    uint32_t now = getTimestamp();
+    uint32_t interval = now - lastSendTime;
+
+    if (interval < getTimerFrequency() / telRate) {
+        return;
+    }
+    lastSendTime = now;
+    elapsedTicks += interval;
+
+    // The recorder has the link to itself while it dumps
+    if (isRecorderDumping()) {
+        return;
+    }
+
+    if (telMode == TEL_MODE_BINARY) {
+        scheduleChannels();
+        if (pendingChannels != 0) {
+            sendTelemetryFrame((uint32_t)(elapsedTicks * 1000000 / getTimerFrequency()));
+        }
+    } else {
+        UARTSendData();
+    }
+}
+
+//
+// Gets the number of binary frames skipped
+//
+uint32_t getTelemetrySkipped(void)
+{
+    return skipped;
+}
@@ -0,0 +1,59 @@
+//*****************************************************************************
+//
+// telemetry.h - Sends the heli's state over serial at a set rate, either
+// as the text status line or as binary frames laid out by
+// telemetryFields.h.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "telemetryFields.h"
+
+//
+// Initialises telemetry and its parameters
+//
+void initTelemetry(void);
+
+//
+// Kernel task, sends telemetry when it is due
+//
+void sendTelemetry(void);
+
+//
+// Gets the number of binary frames skipped because the transmit queue
+// was too full for any of their channels
+//
+uint32_t getTelemetrySkipped(void);
+
+//
+// Finds a channel (telemetry field) by name, NUM_TEL_FIELDS if there
+// isn't one
+//
+uint8_t findTelemetryChannel(const char *name);
+
+//
+// Gets the name of a channel
+//
+const char *getTelemetryChannelName(uint8_t channel);
+
+//
+// Puts a value in a frame, little-endian, and returns the next byte
+//
+uint8_t *packTelemetryValue(uint8_t *frame, telType_t type, uint32_t value);
+
+//
+// Adds the CRC to a frame of len bytes, COBS encodes it and queues it
+// whole.  The frame needs TEL_CRC_LEN bytes of room after it, and can be
+// at most TEL_MAX_FRAME_LEN with the CRC.  Returns false if the transmit
+// queue didn't have room.
+//
+bool queueTelemetryFrame(uint8_t *frame, uint16_t len);
+
+#endif /*TELEMETRY_H_*/
@@ -0,0 +1,87 @@
+//*****************************************************************************
+//
+// telemetryFields.h - Binary telemetry frame layout, shared by the
+// firmware and the host tools.  The field table is the only description
+// of the frame, both ends expand it to pack and unpack the fields.
+//
+// A frame is, little-endian and packed:
+//   type (u8), sequence (u16), time in us (u32), the fields in table
+//   order, CRC-16/CCITT-FALSE of everything before it (u16)
+// It is then COBS encoded and ended with a zero byte.  A masked frame
+// has a channel mask (u32, bit n for field n) after the time, and only
+// the fields in the mask.  The table can't grow past 32 fields.
+//
+// No firmware headers are included here.  The last column of the table
+// is the firmware expression for a field, and is only expanded there.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#ifndef TELEMETRYFIELDS_H_
+#define TELEMETRYFIELDS_H_
+
+#include <stdint.h>
+
+// Frame types
+#define TEL_FRAME_FULL      1   // Every field in the table
+#define TEL_FRAME_MASKED    2   // The fields in the channel mask
+#define TEL_FRAME_RECORD    3   // A black box record, laid out as masked
+
+// Byte sizes of the parts of a frame
+#define TEL_HEADER_LEN      7
+#define TEL_CRC_LEN         2
+#define TEL_MASK_LEN        4
+
+//
+// Field value types
+//
+enum telTypes {TEL_U8 = 0, TEL_I16, TEL_U16, TEL_I32, TEL_U32};
+typedef enum telTypes telType_t;
+
+#define TEL_TYPE_SIZE(type) \
+    ((type) == TEL_U8 ? 1 : ((type) == TEL_I16 || (type) == TEL_U16) ? 2 : 4)
+
+//
+// Field table: X(id, name, type, firmware source)
+//
+#define TELEMETRY_FIELDS(X) \
+    X(YAW,          "yaw",          TEL_I16, getCurrentYaw())                       /* 0.1 deg */ \
+    X(TARGET_YAW,   "target_yaw",   TEL_I16, getTargetYaw())                        /* 0.1 deg */ \
+    X(ALTITUDE,     "altitude",     TEL_I16, getTargetAltitude() - getAltitudeError()) /* % */ \
+    X(TARGET_ALT,   "target_alt",   TEL_I16, getTargetAltitude())                   /* % */ \
+    X(ALT_ADC,      "alt_adc",      TEL_U16, getAltitudeADC())                      /* counts */ \
+    X(MAIN_DUTY,    "main_duty",    TEL_U16, getMainDuty())                         /* Q15 */ \
+    X(TAIL_DUTY,    "tail_duty",    TEL_U16, getTailDuty())                         /* Q15 */ \
+    X(YAW_I,        "yaw_i",        TEL_I16, getYI())                               /* duty % */ \
+    X(ALT_I,        "alt_i",        TEL_I16, getAI())                               /* duty % */ \
+    X(STATE,        "state",        TEL_U8,  getHeliState())                        \
+    X(CONTROL_DT,   "control_dt",   TEL_U32, timing.lastUs)                         /* us */ \
+    X(CONTROL_JIT,  "control_jit",  TEL_U32, timing.jitterUs)                       /* us */ \
+    X(TX_DROPPED,   "tx_dropped",   TEL_U32, getUARTDropped())                      /* bytes */ \
+    X(TEL_SKIPPED,  "tel_skipped",  TEL_U32, getTelemetrySkipped())                 /* frames */ \
+    X(KERNEL_PASSES, "kernel_passes", TEL_U32, getKernelPasses())
+
+//
+// Field IDs, in frame order
+//
+#define TEL_FIELD_ID(id, name, type, source) TEL_##id,
+enum telFields {
+    TELEMETRY_FIELDS(TEL_FIELD_ID)
+    NUM_TEL_FIELDS
+};
+#undef TEL_FIELD_ID
+
+// Length of the fields of a full frame
+#define TEL_FIELD_SIZE(id, name, type, source) + TEL_TYPE_SIZE(type)
+#define TEL_FIELDS_LEN (0 TELEMETRY_FIELDS(TEL_FIELD_SIZE))
+
+// Length of a full frame before COBS encoding, and the longest masked one
+#define TEL_FRAME_LEN (TEL_HEADER_LEN + TEL_FIELDS_LEN + TEL_CRC_LEN)
+#define TEL_MAX_FRAME_LEN (TEL_FRAME_LEN + TEL_MASK_LEN)
+
+// Mask with every channel set
+#define TEL_ALL_FIELDS ((uint32_t)(((uint64_t)1 << NUM_TEL_FIELDS) - 1))
+
+#endif /*TELEMETRYFIELDS_H_*/
@@ -0,0 +1,68 @@
+//*****************************************************************************
+//
+// timer.c - Free running hardware timer used to timestamp events and
+// measure intervals.  Timer 0 counts up at the system clock as a single
+// 32 bit timer, so it wraps roughly every 214 s at 20 MHz.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+
+#include "timer.h"
+
+// Timestamp timer config
+#define TIMESTAMP_PERIPH    SYSCTL_PERIPH_TIMER0
+#define TIMESTAMP_BASE      TIMER0_BASE
+
+// Timer ticks per second and per microsecond
+static uint32_t timerFrequency;
+static uint32_t ticksPerMicro;
+
+//
+// Initialises the free running timestamp timer
+//
+void initTimer(void)
+{
+    SysCtlPeripheralEnable(TIMESTAMP_PERIPH);
+    while (!SysCtlPeripheralReady(TIMESTAMP_PERIPH)) {}
+
+    // Full width periodic timer counting up over the whole 32 bit range
+    TimerConfigure(TIMESTAMP_BASE, TIMER_CFG_PERIODIC_UP);
+    TimerLoadSet(TIMESTAMP_BASE, TIMER_A, 0xFFFFFFFF);
+    TimerEnable(TIMESTAMP_BASE, TIMER_A);
+
+    timerFrequency = SysCtlClockGet();
+    ticksPerMicro = timerFrequency / 1000000;
+}
+
+//
+// Gets the current timestamp in timer ticks
+//
+uint32_t getTimestamp(void)
+{
+    return TimerValueGet(TIMESTAMP_BASE, TIMER_A);
+}
+
+//
+// Gets the number of timer ticks per second
+//
+uint32_t getTimerFrequency(void)
+{
+    return timerFrequency;
+}
+
+//
+// Converts an interval in timer ticks to microseconds
+//
+uint32_t ticksToMicros(uint32_t ticks)
+{
+    return ticks / ticksPerMicro;
+}
@@ -0,0 +1,37 @@
+//*****************************************************************************
+//
+// timer.h - Free running hardware timer used to timestamp events and
+// measure intervals
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#ifndef TIMER_H_
+#define TIMER_H_
+
+#include <stdint.h>
+
+//
+// Initialises the free running timestamp timer
+//
+void initTimer(void);
+
+//
+// Gets the current timestamp in timer ticks.  Wraps, so compare
+// timestamps by unsigned subtraction.
+//
+uint32_t getTimestamp(void);
+
+//
+// Gets the number of timer ticks per second
+//
+uint32_t getTimerFrequency(void);
+
+//
+// Converts an interval in timer ticks to microseconds
+//
+uint32_t ticksToMicros(uint32_t ticks);
+
+#endif /*TIMER_H_*/
@@ -0,0 +1,333 @@
+//*****************************************************************************
+//
+// oledcheck.c - Host check of the asynchronous OLED driver against a model
+// of the panel.  oled.c is built in with the driverlib calls it makes
+// replaced by a model of SSI3, its 8 byte TX FIFO, the data/command pin
+// and an SSD1306 in page addressing mode.  Bytes are latched by the panel
+// as they leave the FIFO, with the data/command level at that time, and
+// the end of transmission interrupt runs the driver's handler once the
+// FIFO is empty.
+//
+// Random drawing, flushes and partly drained transfers are interleaved,
+// then the transfers are run to the end and the panel's RAM is compared
+// with the driver's framebuffer.  Also reported as errors: the data/command
+// pin changing with bytes still in the FIFO, a write to any other pin, an
+// overrun FIFO and unknown commands.
+//
+// Build (Linux, from this directory), with TIVAWARE the TivaWare root and
+// ORBIT the directory holding the OrbitOLED library:
+//   gcc -O2 -Wall -I.. -I$TIVAWARE -I$ORBIT -o oledcheck oledcheck.c
+//
+// Usage:
+//   oledcheck [seed] [steps]
+//
+// Exits 0 if the panel matches the framebuffer and no errors were seen.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "inc/hw_types.h"
+
+// The driver's register writes go to a dummy register on the host
+static uint32_t hostRegister;
+#undef HWREG
+#define HWREG(x) (hostRegister)
+
+#include "oled.c"
+
+#define DEFAULT_SEED    1
+#define DEFAULT_STEPS   100000
+#define MAX_STRING_LEN  6
+
+// SSD1306 commands the driver sends, masks and values
+#define CMD_PAGE_MASK   0xF8
+#define CMD_COL_MASK    0xF0
+
+// Font the driver draws with, filled with a pattern per glyph
+unsigned char rgbOledFont0[(OLED_FONT_LAST - OLED_FONT_FIRST + 1) * OLED_GLYPH_WIDTH];
+
+// Panel RAM and address pointers
+static uint8_t panel[OLED_PAGES][OLED_WIDTH];
+static uint8_t panelPage = 0;
+static uint8_t panelCol = 0;
+
+// Data/command level, high for data
+static bool dataSelected = true;
+
+// SSI TX FIFO and interrupt
+static uint8_t fifo[OLED_FIFO_DEPTH];
+static uint8_t fifoHead = 0;
+static uint8_t fifoCount = 0;
+static bool txIntEnabled = false;
+static void (*ssiHandler)(void) = NULL;
+static bool masterMasked = false;
+
+static uint32_t errors = 0;
+static uint32_t bytesLatched = 0;
+
+//
+// Reports an error, only the first few are printed
+//
+static void reportError(const char *message, uint32_t value)
+{
+    if (errors < 10) {
+        fprintf(stderr, "error: %s (%u)\n", message, (unsigned)value);
+    }
+    errors++;
+}
+
+//
+// Latches a byte that has left the FIFO into the panel
+//
+static void latchByte(uint8_t byte)
+{
+    bytesLatched++;
+    if (dataSelected) {
+        if (panelPage < OLED_PAGES) {
+            panel[panelPage][panelCol] = byte;
+        } else {
+            reportError("data for a page off the panel", panelPage);
+        }
+        // Page addressing wraps within the page
+        panelCol = (panelCol + 1) % OLED_WIDTH;
+    } else if ((byte & CMD_PAGE_MASK) == OLED_CMD_PAGE) {
+        panelPage = byte & ~CMD_PAGE_MASK;
+    } else if ((byte & CMD_COL_MASK) == OLED_CMD_COL_LOW) {
+        panelCol = (panelCol & 0xF0) | (byte & 0x0F);
+    } else if ((byte & CMD_COL_MASK) == OLED_CMD_COL_HIGH) {
+        panelCol = ((byte & 0x0F) << 4) | (panelCol & 0x0F);
+    } else {
+        reportError("unknown command", byte);
+    }
+}
+
+//
+// Shifts up to count bytes out of the FIFO into the panel
+//
+static void shiftOut(uint8_t count)
+{
+    while (count-- > 0 && fifoCount > 0) {
+        latchByte(fifo[fifoHead]);
+        fifoHead = (fifoHead + 1) % OLED_FIFO_DEPTH;
+        fifoCount--;
+    }
+}
+
+//
+// Runs the SSI interrupt if it is due: enabled, unmasked and the FIFO empty
+//
+static bool runInterrupt(void)
+{
+    if (!txIntEnabled || masterMasked || fifoCount > 0 || ssiHandler == NULL) {
+        return false;
+    }
+    ssiHandler();
+    return true;
+}
+
+//
+// Runs the transfers until the driver is idle
+//
+static void finishTransfer(void)
+{
+    uint32_t passes = 0;
+
+    while (isOLEDBusy()) {
+        shiftOut(OLED_FIFO_DEPTH);
+        if (!runInterrupt() || ++passes > OLED_PAGES * OLED_WIDTH) {
+            reportError("transfer stalled", passes);
+            return;
+        }
+    }
+}
+
+//
+// Returns true if a page still has changes to send
+//
+static bool isFrameDirty(void)
+{
+    uint8_t page;
+
+    for (page = 0; page < OLED_PAGES; page++) {
+        if (dirtyStart[page] < dirtyEnd[page]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//
+// Compares the panel with the framebuffer, returns the number of columns
+// that differ
+//
+static uint32_t comparePanel(void)
+{
+    uint32_t differ = 0;
+    uint8_t page;
+    uint8_t x;
+
+    for (page = 0; page < OLED_PAGES; page++) {
+        for (x = 0; x < OLED_WIDTH; x++) {
+            if (panel[page][x] != frame[page][x]) {
+                if (differ < 10) {
+                    fprintf(stderr, "page %u col %u: panel %02x, frame %02x\n",
+                            page, x, panel[page][x], frame[page][x]);
+                }
+                differ++;
+            }
+        }
+    }
+    return differ;
+}
+
+//
+// Draws a random short string somewhere on the screen
+//
+static void drawRandomString(void)
+{
+    char string[MAX_STRING_LEN + 1];
+    uint8_t len = rand() % MAX_STRING_LEN + 1;
+    uint8_t i;
+
+    for (i = 0; i < len; i++) {
+        string[i] = OLED_FONT_FIRST + rand() % (OLED_FONT_LAST - OLED_FONT_FIRST + 1);
+    }
+    string[len] = '\0';
+    drawOLEDString(string, rand() % OLED_TEXT_COLS, rand() % OLED_TEXT_ROWS);
+}
+
+//
+// Driverlib and vendor library calls oled.c makes, on the model
+//
+bool IntMasterDisable(void)
+{
+    bool was = masterMasked;
+    masterMasked = true;
+    return was;
+}
+
+bool IntMasterEnable(void)
+{
+    bool was = masterMasked;
+    masterMasked = false;
+    return was;
+}
+
+void IntPrioritySet(uint32_t interrupt, uint8_t priority)
+{
+}
+
+void SSIEnable(uint32_t base)
+{
+}
+
+void SSIDisable(uint32_t base)
+{
+}
+
+void SSIIntRegister(uint32_t base, void (*handler)(void))
+{
+    ssiHandler = handler;
+}
+
+void SSIIntEnable(uint32_t base, uint32_t flags)
+{
+    txIntEnabled = true;
+}
+
+void SSIIntDisable(uint32_t base, uint32_t flags)
+{
+    txIntEnabled = false;
+}
+
+int32_t SSIDataPutNonBlocking(uint32_t base, uint32_t data)
+{
+    if (fifoCount == OLED_FIFO_DEPTH) {
+        reportError("TX FIFO overrun", data);
+        return 0;
+    }
+    fifo[(fifoHead + fifoCount) % OLED_FIFO_DEPTH] = data;
+    fifoCount++;
+    return 1;
+}
+
+void GPIOPinWrite(uint32_t port, uint8_t pins, uint8_t value)
+{
+    if (port != nDC_OLEDPort || pins != nDC_OLED) {
+        reportError("write to a pin other than data/command", pins);
+        return;
+    }
+    bool level = (value & pins) != 0;
+    if (level != dataSelected && fifoCount > 0) {
+        reportError("data/command changed with bytes in the FIFO", fifoCount);
+    }
+    dataSelected = level;
+}
+
+void OLEDInitialise(void)
+{
+    memset(panel, 0, sizeof(panel));
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t seed = (argc > 1) ? strtoul(argv[1], NULL, 0) : DEFAULT_SEED;
+    uint32_t steps = (argc > 2) ? strtoul(argv[2], NULL, 0) : DEFAULT_STEPS;
+    uint32_t i;
+
+    if (argc > 3) {
+        fprintf(stderr, "usage: %s [seed] [steps]\n", argv[0]);
+        return 1;
+    }
+
+    for (i = 0; i < sizeof(rgbOledFont0); i++) {
+        rgbOledFont0[i] = (uint8_t)(i * 37 + 11);
+    }
+    srand(seed);
+    initOLED();
+
+    // Drawing and flushing while transfers run, a few bytes at a time
+    for (i = 0; i < steps; i++) {
+        switch (rand() % 5) {
+        case 0:
+            setOLEDColumn(rand() % OLED_WIDTH, rand() % OLED_PAGES, rand());
+            break;
+        case 1:
+            drawRandomString();
+            break;
+        case 2:
+            flushOLED();
+            break;
+        case 3:
+            if (rand() % 64 == 0) {
+                clearOLED();
+            }
+            break;
+        default:
+            shiftOut(rand() % (OLED_FIFO_DEPTH / 2 + 1));
+            runInterrupt();
+            break;
+        }
+    }
+
+    // Sends whatever is left
+    finishTransfer();
+    while (isFrameDirty()) {
+        flushOLED();
+        finishTransfer();
+    }
+
+    uint32_t differ = comparePanel();
+    printf("seed %u, %u steps: %u bytes latched, %u columns differ, %u errors\n",
+           (unsigned)seed, (unsigned)steps, (unsigned)bytesLatched, (unsigned)differ,
+           (unsigned)errors);
+    return (differ == 0 && errors == 0) ? 0 : 1;
+}
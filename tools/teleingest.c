@@ -0,0 +1,421 @@
+//*****************************************************************************
+//
+// teleingest.c - Host tool that reads the heli's binary telemetry (set
+// tel_mode to 1) from a serial device, pty or capture file and writes it
+// out as columns: one raw little-endian array per field, which can be
+// mmap'd straight into numpy etc, plus an optional CSV.
+//
+// Frames are COBS decoded in place in the read buffer and checked against
+// their CRC and length.  Sequence gaps are counted as dropped frames, bad
+// frames as corrupt.  A corrupt frame also leaves a gap, so it shows in
+// both counts.
+//
+// Build (Linux, from this directory):
+//   gcc -O2 -Wall -I.. -o teleingest teleingest.c ../cobs.c ../crc16.c
+//
+// Usage:
+//   teleingest [-b baud] [-c file.csv] <device or file> <output dir>
+//
+// The output directory gets <field>.bin for every field in
+// telemetryFields.h, plus seq.bin (u16), time_us.bin (u32), mask.bin
+// (u32) and a columns.txt listing each column's type and sample count.
+// Every column has a row per frame.  A field missing from a masked frame
+// repeats its last value, and its bit in mask.bin is clear.  In the CSV
+// it is left empty.
+//
+// Black box dumps ("bb dump") come as record frames, laid out like masked
+// ones and numbered from 0 in each dump, and are stored the same way.
+// Capture a dump into its own directory to keep it apart from the live
+// telemetry.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/stat.h>
+
+#include "cobs.h"
+#include "crc16.h"
+#include "telemetryFields.h"
+
+#define READ_BUF_SIZE   65536
+#define MAX_PATH_LEN    512
+#define DEFAULT_BAUD    9600
+
+//
+// A field from the table and the file its column goes to
+//
+typedef struct {
+    const char *name;
+    telType_t type;
+    FILE *column;
+    uint8_t last[4];    // Last value, repeated when the field is missing
+} field_t;
+
+#define TEL_FIELD_INFO(id, name, type, source) {name, type, NULL, {0}},
+static field_t fields[NUM_TEL_FIELDS] = {
+    TELEMETRY_FIELDS(TEL_FIELD_INFO)
+};
+#undef TEL_FIELD_INFO
+
+static const char *typeNames[] = {"u8", "i16", "u16", "i32", "u32"};
+
+// Header columns
+static FILE *seqColumn;
+static FILE *timeColumn;
+static FILE *maskColumn;
+static FILE *csv = NULL;
+
+// Stream statistics
+static uint64_t goodFrames = 0;
+static uint64_t corruptFrames = 0;
+static uint64_t droppedFrames = 0;
+static bool haveSequence[2] = {false, false};   // Live telemetry, records
+static uint16_t lastSequence[2];
+
+static volatile sig_atomic_t stopping = 0;
+
+//
+// Stops reading on ctrl-c, so the columns are flushed
+//
+static void handleSignal(int sig)
+{
+    (void)sig;
+    stopping = 1;
+}
+
+//
+// Reads a little-endian value of a field type, sign extended
+//
+static int64_t readValue(const uint8_t *data, telType_t type)
+{
+    switch (type) {
+    case TEL_U8:
+        return data[0];
+    case TEL_I16:
+        return (int16_t)(data[0] | data[1] << 8);
+    case TEL_U16:
+        return (uint16_t)(data[0] | data[1] << 8);
+    case TEL_I32:
+        return (int32_t)((uint32_t)data[0] | (uint32_t)data[1] << 8
+                         | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24);
+    default:
+        return (uint32_t)data[0] | (uint32_t)data[1] << 8
+                | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+    }
+}
+
+//
+// Opens a column file in the output directory
+//
+static FILE *openColumn(const char *dir, const char *name)
+{
+    char path[MAX_PATH_LEN];
+    FILE *file;
+
+    snprintf(path, sizeof(path), "%s/%s.bin", dir, name);
+    file = fopen(path, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "teleingest: can't create %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    return file;
+}
+
+//
+// Sets a serial device to raw mode at the baud rate.  Anything that
+// isn't a terminal (a capture file) is left alone.
+//
+static void configureSerial(int fd, long baud)
+{
+    struct termios tio;
+    speed_t speed;
+
+    if (!isatty(fd)) {
+        return;
+    }
+
+    switch (baud) {
+    case 9600:      speed = B9600; break;
+    case 19200:     speed = B19200; break;
+    case 38400:     speed = B38400; break;
+    case 57600:     speed = B57600; break;
+    case 115200:    speed = B115200; break;
+    case 230400:    speed = B230400; break;
+    case 460800:    speed = B460800; break;
+    case 921600:    speed = B921600; break;
+    default:
+        fprintf(stderr, "teleingest: unsupported baud rate %ld\n", baud);
+        exit(1);
+    }
+
+    if (tcgetattr(fd, &tio) != 0) {
+        perror("teleingest: tcgetattr");
+        exit(1);
+    }
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+        perror("teleingest: tcsetattr");
+        exit(1);
+    }
+}
+
+//
+// Gets the length a frame should be from its header, -1 if it can't be
+// a frame
+//
+static int32_t getFrameLength(const uint8_t *frame, int32_t len, uint32_t *mask)
+{
+    int32_t expected = TEL_HEADER_LEN + TEL_CRC_LEN;
+    uint8_t i;
+
+    if (len < TEL_HEADER_LEN + TEL_CRC_LEN) {
+        return -1;
+    }
+    if (frame[0] == TEL_FRAME_FULL) {
+        *mask = TEL_ALL_FIELDS;
+    } else if ((frame[0] == TEL_FRAME_MASKED || frame[0] == TEL_FRAME_RECORD) && len >= TEL_HEADER_LEN + TEL_MASK_LEN + TEL_CRC_LEN) {
+        *mask = readValue(frame + TEL_HEADER_LEN, TEL_U32);
+        expected += TEL_MASK_LEN;
+        if (*mask & ~TEL_ALL_FIELDS) {
+            return -1;
+        }
+    } else {
+        return -1;
+    }
+
+    for (i = 0; i < NUM_TEL_FIELDS; i++) {
+        if (*mask & (1UL << i)) {
+            expected += TEL_TYPE_SIZE(fields[i].type);
+        }
+    }
+    return expected;
+}
+
+//
+// Checks and stores one decoded frame
+//
+static void processFrame(const uint8_t *frame, int32_t len)
+{
+    const uint8_t *next = frame + TEL_HEADER_LEN;
+    uint32_t mask;
+    uint8_t i;
+
+    if (getFrameLength(frame, len, &mask) != len
+            || getCRC16(frame, len - TEL_CRC_LEN) != readValue(frame + len - TEL_CRC_LEN, TEL_U16)) {
+        corruptFrames++;
+        return;
+    }
+    if (frame[0] != TEL_FRAME_FULL) {
+        next += TEL_MASK_LEN;
+    }
+
+    uint16_t sequence = readValue(frame + 1, TEL_U16);
+    uint32_t timeUs = readValue(frame + 3, TEL_U32);
+    uint8_t stream = (frame[0] == TEL_FRAME_RECORD);
+
+    // Gaps in the sequence are frames lost on the way, or skipped by the
+    // firmware when its transmit queue was full.  Each dump starts again
+    // from record 0.
+    if (haveSequence[stream] && !(stream && sequence == 0)) {
+        droppedFrames += (uint16_t)(sequence - lastSequence[stream] - 1);
+    }
+    lastSequence[stream] = sequence;
+    haveSequence[stream] = true;
+    goodFrames++;
+
+    fwrite(frame + 1, 2, 1, seqColumn);
+    fwrite(frame + 3, 4, 1, timeColumn);
+    fwrite(&mask, 4, 1, maskColumn);
+    if (csv != NULL) {
+        fprintf(csv, "%u,%u", sequence, timeUs);
+    }
+
+    for (i = 0; i < NUM_TEL_FIELDS; i++) {
+        uint8_t size = TEL_TYPE_SIZE(fields[i].type);
+
+        if (!(mask & (1UL << i))) {
+            fwrite(fields[i].last, size, 1, fields[i].column);
+            if (csv != NULL) {
+                fputc(',', csv);
+            }
+            continue;
+        }
+        memcpy(fields[i].last, next, size);
+        fwrite(next, size, 1, fields[i].column);
+        if (csv != NULL) {
+            fprintf(csv, ",%lld", (long long)readValue(next, fields[i].type));
+        }
+        next += size;
+    }
+    if (csv != NULL) {
+        fputc('\n', csv);
+    }
+}
+
+//
+// Writes the column list with the final sample count
+//
+static void writeManifest(const char *dir)
+{
+    char path[MAX_PATH_LEN];
+    FILE *manifest;
+    uint8_t i;
+
+    snprintf(path, sizeof(path), "%s/columns.txt", dir);
+    manifest = fopen(path, "w");
+    if (manifest == NULL) {
+        fprintf(stderr, "teleingest: can't create %s: %s\n", path, strerror(errno));
+        return;
+    }
+    fprintf(manifest, "seq u16 %llu\n", (unsigned long long)goodFrames);
+    fprintf(manifest, "time_us u32 %llu\n", (unsigned long long)goodFrames);
+    fprintf(manifest, "mask u32 %llu\n", (unsigned long long)goodFrames);
+    for (i = 0; i < NUM_TEL_FIELDS; i++) {
+        fprintf(manifest, "%s %s %llu\n", fields[i].name, typeNames[fields[i].type],
+                (unsigned long long)goodFrames);
+    }
+    fclose(manifest);
+}
+
+int main(int argc, char *argv[])
+{
+    static uint8_t buffer[READ_BUF_SIZE];
+    size_t used = 0;
+    long baud = DEFAULT_BAUD;
+    const char *csvPath = NULL;
+    int opt;
+    uint8_t i;
+
+    while ((opt = getopt(argc, argv, "b:c:")) != -1) {
+        switch (opt) {
+        case 'b':
+            baud = strtol(optarg, NULL, 10);
+            break;
+        case 'c':
+            csvPath = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-b baud] [-c file.csv] <device or file> <output dir>\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (argc - optind != 2) {
+        fprintf(stderr, "usage: %s [-b baud] [-c file.csv] <device or file> <output dir>\n",
+                argv[0]);
+        return 1;
+    }
+    const char *input = argv[optind];
+    const char *dir = argv[optind + 1];
+
+    int fd = open(input, O_RDONLY | O_NOCTTY);
+    if (fd < 0) {
+        fprintf(stderr, "teleingest: can't open %s: %s\n", input, strerror(errno));
+        return 1;
+    }
+    configureSerial(fd, baud);
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "teleingest: can't create %s: %s\n", dir, strerror(errno));
+        return 1;
+    }
+    seqColumn = openColumn(dir, "seq");
+    timeColumn = openColumn(dir, "time_us");
+    maskColumn = openColumn(dir, "mask");
+    for (i = 0; i < NUM_TEL_FIELDS; i++) {
+        fields[i].column = openColumn(dir, fields[i].name);
+    }
+    if (csvPath != NULL) {
+        csv = fopen(csvPath, "w");
+        if (csv == NULL) {
+            fprintf(stderr, "teleingest: can't create %s: %s\n", csvPath, strerror(errno));
+            return 1;
+        }
+        fprintf(csv, "seq,time_us");
+        for (i = 0; i < NUM_TEL_FIELDS; i++) {
+            fprintf(csv, ",%s", fields[i].name);
+        }
+        fputc('\n', csv);
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handleSignal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    // The first frame is usually joined part way through, and is dropped
+    // as corrupt unless the stream starts at a frame boundary
+    while (!stopping) {
+        ssize_t got = read(fd, buffer + used, sizeof(buffer) - used);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("teleingest: read");
+            break;
+        } else if (got == 0) {
+            break;      // End of a capture file
+        }
+        used += got;
+
+        // Decodes each complete frame where it lies in the buffer
+        size_t start = 0;
+        uint8_t *zero;
+        while ((zero = memchr(buffer + start, 0, used - start)) != NULL) {
+            size_t len = zero - (buffer + start);
+
+            if (len > 0) {
+                int32_t decoded = (len <= COBS_MAX_LEN(TEL_MAX_FRAME_LEN))
+                        ? decodeCOBS(buffer + start, len, buffer + start) : -1;
+                if (decoded < 0) {
+                    corruptFrames++;
+                } else {
+                    processFrame(buffer + start, decoded);
+                }
+            }
+            start += len + 1;
+        }
+
+        // Keeps the partial frame, or drops it if it can never end
+        if (used - start == sizeof(buffer)) {
+            corruptFrames++;
+            used = 0;
+        } else {
+            memmove(buffer, buffer + start, used - start);
+            used -= start;
+        }
+    }
+
+    fclose(seqColumn);
+    fclose(timeColumn);
+    fclose(maskColumn);
+    for (i = 0; i < NUM_TEL_FIELDS; i++) {
+        fclose(fields[i].column);
+    }
+    if (csv != NULL) {
+        fclose(csv);
+    }
+    writeManifest(dir);
+    close(fd);
+
+    fprintf(stderr, "frames=%llu corrupt=%llu dropped=%llu\n", (unsigned long long)goodFrames,
+            (unsigned long long)corruptFrames, (unsigned long long)droppedFrames);
+    return 0;
+}
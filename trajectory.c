@@ -0,0 +1,153 @@
+//*****************************************************************************
+//
+// trajectory.c - Trapezoidal setpoint trajectories.  Turns steps in a
+// target into a reference that moves with limited velocity and
+// acceleration, updated incrementally every control update.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#ifdef PID_FLOAT
+#include <math.h>
+#endif
+
+#include "trajectory.h"
+
+//
+// Wraps a value of an angular axis into +/- wrap/2
+//
+static pidNum_t wrapTrajectory(const trajectory_t *traj, pidNum_t value)
+{
+    if (traj->wrap > 0) {
+        while (value >= traj->wrap / 2)
+            value -= traj->wrap;
+        while (value < -traj->wrap / 2)
+            value += traj->wrap;
+    }
+    return value;
+}
+
+//
+// Initialises a trajectory at rest at the given position
+//
+void initTrajectory(trajectory_t *traj, pidNum_t maxVelocity, pidNum_t maxAccel,
+                    pidNum_t wrap, pidNum_t position)
+{
+    traj->maxVelocity = maxVelocity;
+    traj->maxAccel = maxAccel;
+    traj->wrap = wrap;
+    resetTrajectory(traj, position);
+}
+
+//
+// Sets the max velocity of the trajectory
+//
+void setTrajectoryMaxVelocity(trajectory_t *traj, pidNum_t maxVelocity)
+{
+    traj->maxVelocity = maxVelocity;
+}
+
+//
+// Sets the target the trajectory moves towards
+//
+void setTrajectoryTarget(trajectory_t *traj, pidNum_t target)
+{
+    traj->target = wrapTrajectory(traj, target);
+}
+
+//
+// Jumps the trajectory to rest at the given position
+//
+void resetTrajectory(trajectory_t *traj, pidNum_t position)
+{
+    traj->position = wrapTrajectory(traj, position);
+    traj->target = traj->position;
+    traj->velocity = 0;
+}
+
+//
+// Square root of a non-negative value
+//
+static pidNum_t sqrtTrajectory(pidNum_t value)
+{
+#ifdef PID_FLOAT
+    return sqrtf(value);
+#else
+    // Bitwise integer square root, sqrt(x << 16) keeps the Q16.16 scaling
+    uint64_t x = (uint64_t)value << PID_FRAC_BITS;
+    uint64_t result = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+
+    while (bit > x)
+        bit >>= 2;
+    while (bit != 0) {
+        if (x >= result + bit) {
+            x -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (pidNum_t)result;
+#endif
+}
+
+//
+// Advances the trajectory by dt and returns the position reference.
+// The velocity moves towards the fastest speed that can still stop on the
+// target, sqrt(2 * a * distance), limited to the max velocity.
+//
+pidNum_t updateTrajectory(trajectory_t *traj, pidNum_t dt)
+{
+    pidNum_t distance = wrapTrajectory(traj, traj->target - traj->position);
+    pidNum_t remaining = distance >= 0 ? distance : -distance;
+    pidNum_t dv = PID_MUL(traj->maxAccel, dt);
+
+    // Stops on the target once it is within one small step
+    if (remaining <= PID_MUL(dv, dt) && traj->velocity <= dv && traj->velocity >= -dv) {
+        traj->position = traj->target;
+        traj->velocity = 0;
+        return traj->position;
+    }
+
+    // Fastest speed towards the target, never past it in one update.
+    // Past the braking distance of the max velocity it is just the max.
+    pidNum_t speed = traj->maxVelocity;
+    if (remaining < PID_DIV(PID_MUL(speed, speed), 2 * traj->maxAccel)) {
+        speed = sqrtTrajectory(2 * PID_MUL(traj->maxAccel, remaining));
+    }
+    if (dt > 0 && speed > PID_DIV(remaining, dt)) {
+        speed = PID_DIV(remaining, dt);
+    }
+    pidNum_t desired = distance >= 0 ? speed : -speed;
+
+    // Speeds up or turns around at the max acceleration, and follows the
+    // braking curve down so it doesn't overshoot
+    bool braking = (traj->velocity > 0 && desired >= 0 && desired < traj->velocity)
+            || (traj->velocity < 0 && desired <= 0 && desired > traj->velocity);
+    if (braking) {
+        traj->velocity = desired;
+    } else if (desired > traj->velocity + dv) {
+        traj->velocity += dv;
+    } else if (desired < traj->velocity - dv) {
+        traj->velocity -= dv;
+    } else {
+        traj->velocity = desired;
+    }
+
+    traj->position = wrapTrajectory(traj, traj->position + PID_MUL(traj->velocity, dt));
+    return traj->position;
+}
+
+//
+// Checks if the trajectory has reached its target
+//
+bool isTrajectoryDone(const trajectory_t *traj)
+{
+    return traj->position == traj->target && traj->velocity == 0;
+}
@@ -0,0 +1,64 @@
+//*****************************************************************************
+//
+// trajectory.h - Trapezoidal setpoint trajectories.  Turns steps in a
+// target into a reference that moves with limited velocity and
+// acceleration, updated incrementally every control update.
+//
+// Author:  bma206, tki36
+// Last modified:   19.10.2026
+//
+//*****************************************************************************
+
+#ifndef TRAJECTORY_H_
+#define TRAJECTORY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pid.h"
+
+//
+// Trajectory limits and state
+//
+typedef struct {
+    pidNum_t maxVelocity;   // Units per second
+    pidNum_t maxAccel;      // Units per second squared
+    pidNum_t wrap;          // Range of an angular axis, 0 if it doesn't wrap
+
+    pidNum_t target;
+    pidNum_t position;      // Position reference
+    pidNum_t velocity;      // Velocity reference
+} trajectory_t;
+
+//
+// Initialises a trajectory at rest at the given position.  A non-zero
+// wrap makes the axis angular, wrapping position to +/- wrap/2.
+//
+void initTrajectory(trajectory_t *traj, pidNum_t maxVelocity, pidNum_t maxAccel,
+                    pidNum_t wrap, pidNum_t position);
+
+//
+// Sets the max velocity of the trajectory
+//
+void setTrajectoryMaxVelocity(trajectory_t *traj, pidNum_t maxVelocity);
+
+//
+// Sets the target the trajectory moves towards
+//
+void setTrajectoryTarget(trajectory_t *traj, pidNum_t target);
+
+//
+// Jumps the trajectory to rest at the given position
+//
+void resetTrajectory(trajectory_t *traj, pidNum_t position);
+
+//
+// Advances the trajectory by dt and returns the position reference
+//
+pidNum_t updateTrajectory(trajectory_t *traj, pidNum_t dt);
+
+//
+// Checks if the trajectory has reached its target
+//
+bool isTrajectoryDone(const trajectory_t *traj);
+
+#endif /*TRAJECTORY_H_*/
@@ -4,7 +4,7 @@
 // decoding to calculate the current Yaw of a rotary system
 //
 // Author:  bma206, tki36
-// Last modified:   30.4.2024
+// Last modified:   19.10.2026
 //
 //*****************************************************************************
 
@@ -18,9 +18,11 @@
 #include "driverlib/systick.h"
 #include "driverlib/interrupt.h"
 #include "display.h"
-#include "switch.h"
+#include "flight.h"
 #include "circBufT.h"
 #include "control.h"
+#include "params.h"
+#include "latency.h"
 
 // Yaw input channels/pins
 #define YAW_CHANNEL_A GPIO_PIN_0
@@ -34,7 +36,7 @@
 #define YAW_REF_PIN           GPIO_PIN_4
 
 // Number of slots in the light sensor
-#define NUM_SLOTS 112
+static int32_t numSlots = 112;
 
 // current yaw of the helicopter
 int16_t current_yaw = 0;
@@ -52,6 +54,9 @@ bool newBState = false;
 #define YAW_BUFF_SIZE 20
 static circBuf_t yawErrorBuff;
 
+// Count at the last yaw reference edge
+static volatile int16_t referenceYaw = 0;
+
 //
 // Handles interrupts of the yaw changing
 //
@@ -93,6 +98,8 @@ void yawIntHandler()
     oldBState = newBState;
     // Clear the interrupt
     GPIOIntClear(YAW_BASE, YAW_CHANNEL_A | YAW_CHANNEL_B);
+
+    markLatency(LAT_YAW_EDGE);
 }
 
 //
@@ -100,11 +107,10 @@ void yawIntHandler()
 //
 void yawReferenceHandler(void)
 {
+    // The count is kept so the kernel can zero the yaw where the edge was
     if (getHeliState() == FIND_YAW) {
-        current_yaw = 0;
-        target_yaw = 0;
-        resetYawDI();
-        setHeliState(FLYING);
+        referenceYaw = current_yaw;
+        postFlightEvent(FLIGHT_YAW_REF);
     }
 
     GPIOIntClear(YAW_REF_GPIO_BASE, YAW_REF_PIN);
@@ -142,6 +148,8 @@ void initYaw(void)
     GPIOIntEnable(YAW_REF_GPIO_BASE, YAW_REF_PIN);
 
     initCircBuf(&yawErrorBuff, YAW_BUFF_SIZE);
+
+    registerParam(PARAM_YAW_SLOTS, "yaw_slots", PARAM_INT, &numSlots, 1, 1000, NULL);
 }
 
 //
@@ -150,7 +158,7 @@ void initYaw(void)
 int16_t getCurrentYaw(void)
 {
     // Calculate the yaw in degrees
-    yaw_degrees = current_yaw * 3600 / NUM_SLOTS / 4;
+    yaw_degrees = current_yaw * 3600 / numSlots / 4;
 
     // Makes the yaw in range 0-360 degrees
     while(yaw_degrees >= 1800)
@@ -199,14 +207,26 @@ int32_t getYawError(void)
 }
 
 //
-// Gets helicopter back to reference yaw to land
+// Sets the target yaw, in tenths of a degree
 //
-void resetPosition(void)
+void setTargetYaw(int16_t yaw)
 {
-    target_yaw = 0;
-    if(isSettled()) {
-        setHeliState(LANDING);
+    target_yaw = yaw;
+}
+
+//
+// Makes the last yaw reference edge yaw 0, and targets it
+//
+void setYawReference(void)
+{
+    bool masked = IntMasterDisable();
+    current_yaw -= referenceYaw;
+    if (!masked) {
+        IntMasterEnable();
     }
+
+    target_yaw = 0;
+    resetYawDI();
 }
 
 //
@@ -233,36 +253,23 @@ int32_t yawError(int32_t given_yaw)
 
 
 //
-// Checks if the yaw has settled
+// Gets the average yaw error over the yaw buffer
 //
-bool isSettled(void) 
+uint32_t getAverageYawError(void)
 {
     uint16_t i;
     uint32_t sum = 0;
-    uint32_t yawErrorAvg = 0;
     for (i = 0; i < YAW_BUFF_SIZE; i++)
         sum = sum + yawError((int32_t)readCircBuf(&yawErrorBuff));
-    yawErrorAvg = sum / YAW_BUFF_SIZE;
-
-    if(yawErrorAvg < 40) {
-        return true;
-    }
-    return false;
+    return sum / YAW_BUFF_SIZE;
 }
 
-bool canLand(uint32_t margin)
+//
+// Checks if the yaw has settled
+//
+bool isSettled(void) 
 {
-    uint16_t i;
-    uint32_t sum = 0;
-    uint32_t yawErrorAvg = 0;
-    for (i = 0; i < YAW_BUFF_SIZE; i++)
-        sum = sum + yawError((int32_t)readCircBuf(&yawErrorBuff));
-    yawErrorAvg = sum / YAW_BUFF_SIZE;
-
-    if(yawErrorAvg <= margin) {
-        return true;
-    }
-    return false;
+    return getAverageYawError() < SETTLED_YAW_ERROR;
 }
 
 //
@@ -10,6 +10,9 @@
 #ifndef YAW_H_
 #define YAW_H_
 
+// Average yaw error the yaw is settled within, in tenths of a degree
+#define SETTLED_YAW_ERROR 40
+
 //
 // Initialises the pins and interrupts for yaw to be measured
 //
@@ -36,9 +39,14 @@ void incrementYaw(int16_t increment);
 int32_t getYawError(void);
 
 //
-// Gets helicopter back to reference yaw to land
+// Sets the target yaw, in tenths of a degree
+//
+void setTargetYaw(int16_t yaw);
+
+//
+// Makes the yaw at the last yaw reference edge 0, and targets it
 //
-void resetPosition(void);
+void setYawReference(void);
 
 //
 // Gets the error for Yaw values
@@ -55,7 +63,10 @@ void updateYawBuff(void);
 //
 bool isSettled(void);
 
-bool canLand(uint32_t margin);
+//
+// Gets the average yaw error over the yaw buffer, in tenths of a degree
+//
+uint32_t getAverageYawError(void);
 
 #endif /*YAW_H_*/
 